@@ -0,0 +1,169 @@
+#include "analog_convert.hpp"
+
+#include "siglent_bin.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+analog_calibration_t getAnalogCalibration(const header_t& header, size_t channel)
+{
+  // Code 128 is the center of the screen; full scale is 10.7 divisions over 256 codes
+  const double gain = header.analog_scales[channel].get_value() * 10.7 / 256;
+  const double bias = -128 * gain - header.analog_offsets[channel].get_value();
+
+  return { (float)gain, (float)bias };
+}
+
+void convert_analog_scalar(std::span<const uint8_t> in, const analog_calibration_t& cal, size_t oversample, std::span<float> out)
+{
+  assert(out.size() >= in.size() * oversample);
+
+  for (size_t i = 0; i < in.size(); i++)
+    std::fill_n(out.begin() + i * oversample, oversample, in[i] * cal.gain + cal.bias);
+}
+
+#if defined(__SSE2__)
+
+static void replicate(std::span<const float> in, size_t oversample, std::span<float> out)
+{
+  // Backwards, so that in may be the head of out
+  for (size_t i = in.size(); i-- > 0; )
+    std::fill_n(out.begin() + i * oversample, oversample, in[i]);
+}
+
+static void convert_sse2(const uint8_t* in, size_t n, const analog_calibration_t& cal, float* out)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 gain = _mm_set1_ps(cal.gain);
+  const __m128 bias = _mm_set1_ps(cal.bias);
+
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    // Widen u8 -> u16 -> u32, then to float
+    __m128i codes = _mm_loadu_si128((const __m128i*)(in + i));
+    __m128i lo = _mm_unpacklo_epi8(codes, zero);
+    __m128i hi = _mm_unpackhi_epi8(codes, zero);
+
+    __m128i words[4] = {
+      _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+      _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+    };
+
+    for (int k = 0; k < 4; k++)
+    {
+      __m128 v = _mm_cvtepi32_ps(words[k]);
+      _mm_storeu_ps(out + i + 4 * k, _mm_add_ps(_mm_mul_ps(v, gain), bias));
+    }
+  }
+
+  for (; i < n; i++)
+    out[i] = in[i] * cal.gain + cal.bias;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+__attribute__((target("avx2,fma")))
+static void convert_avx2(const uint8_t* in, size_t n, const analog_calibration_t& cal, float* out)
+{
+  const __m256 gain = _mm256_set1_ps(cal.gain);
+  const __m256 bias = _mm256_set1_ps(cal.bias);
+
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32)
+  {
+    for (int k = 0; k < 4; k++)
+    {
+      __m128i codes = _mm_loadl_epi64((const __m128i*)(in + i + 8 * k));
+      __m256 v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(codes));
+      _mm256_storeu_ps(out + i + 8 * k, _mm256_fmadd_ps(v, gain, bias));
+    }
+  }
+
+  for (; i < n; i++)
+    out[i] = in[i] * cal.gain + cal.bias;
+}
+
+static void convert_block(const uint8_t* in, size_t n, const analog_calibration_t& cal, float* out)
+{
+  static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+  if (has_avx2)
+    convert_avx2(in, n, cal, out);
+  else
+    convert_sse2(in, n, cal, out);
+}
+
+#else
+
+static void convert_block(const uint8_t* in, size_t n, const analog_calibration_t& cal, float* out)
+{
+  convert_sse2(in, n, cal, out);
+}
+
+#endif
+
+void convert_analog(std::span<const uint8_t> in, const analog_calibration_t& cal, size_t oversample, std::span<float> out)
+{
+  assert(out.size() >= in.size() * oversample);
+
+  if (oversample == 1)
+  {
+    convert_block(in.data(), in.size(), cal, out.data());
+    return;
+  }
+
+  // Convert a block into the head of its destination, then spread it out
+  const size_t block = 1024;
+  for (size_t i = 0; i < in.size(); i += block)
+  {
+    const size_t n = std::min(block, in.size() - i);
+    auto dst = out.subspan(i * oversample, n * oversample);
+
+    convert_block(in.data() + i, n, cal, dst.data());
+    replicate(dst.first(n), oversample, dst);
+  }
+}
+
+#else
+
+void convert_analog(std::span<const uint8_t> in, const analog_calibration_t& cal, size_t oversample, std::span<float> out)
+{
+  convert_analog_scalar(in, cal, oversample, out);
+}
+
+#endif
+
+AnalogLut::AnalogLut(const analog_calibration_t& cal)
+{
+  for (size_t code = 0; code < table.size(); code++)
+    table[code] = code * cal.gain + cal.bias;
+}
+
+AnalogLut::AnalogLut(const header_t& header, size_t channel)
+{
+  const double scale = header.analog_scales[channel].get_value();
+  const double offset = header.analog_offsets[channel].get_value();
+
+  // Same arithmetic as the original per-sample conversion, so values are bit exact
+  for (size_t code = 0; code < table.size(); code++)
+    table[code] = (float)(double(int(code) - 128) * scale * 10.7 / 256 - offset);
+}
+
+void AnalogLut::convert(std::span<const uint8_t> in, size_t oversample, std::span<float> out) const
+{
+  assert(out.size() >= in.size() * oversample);
+
+  if (oversample == 1)
+  {
+    std::transform(in.begin(), in.end(), out.begin(), [this] (uint8_t code) { return table[code]; });
+    return;
+  }
+
+  for (size_t i = 0; i < in.size(); i++)
+    std::fill_n(out.begin() + i * oversample, oversample, table[in[i]]);
+}
@@ -0,0 +1,50 @@
+#ifndef ANALOG_CONVERT_HPP_
+#define ANALOG_CONVERT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <span>
+
+struct header_t;
+
+// Linear mapping from 8 bit ADC code to volts: volts = code * gain + bias.
+// The 128 code midpoint and the channel offset are folded into bias.
+struct analog_calibration_t {
+  float gain;
+  float bias;
+};
+
+analog_calibration_t getAnalogCalibration(const header_t& header, size_t channel);
+
+// Converts every code of in to volts, writing each result oversample times in a row,
+// so out must hold in.size() * oversample samples.
+
+// Reference implementation, one sample at a time
+void convert_analog_scalar(std::span<const uint8_t> in, const analog_calibration_t& cal, size_t oversample, std::span<float> out);
+
+// Vectorized implementation (SSE2, or AVX2 + FMA when the CPU has them)
+void convert_analog(std::span<const uint8_t> in, const analog_calibration_t& cal, size_t oversample, std::span<float> out);
+
+// The ADC is 8 bit, so a channel can only ever produce 256 distinct values:
+// this table holds all of them, computed once in double precision.
+// Any consumer of volts (srzip members, CSV, statistics) can share the same table.
+class AnalogLut
+{
+  public:
+
+    explicit AnalogLut(const analog_calibration_t& cal);
+
+    AnalogLut(const header_t& header, size_t channel);
+
+    float operator[](uint8_t code) const { return table[code]; }
+
+    // Same contract as convert_analog
+    void convert(std::span<const uint8_t> in, size_t oversample, std::span<float> out) const;
+
+  private:
+
+    std::array<float, 256> table;
+};
+
+#endif // ANALOG_CONVERT_HPP_
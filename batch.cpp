@@ -0,0 +1,282 @@
+#include "batch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include <glob.h>
+
+#include <spdlog/spdlog.h>
+
+#include "chunking.hpp"
+#include "utils/bounded_queue.hpp"
+#include "utils/thread_pool.hpp"
+#include "watch.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+bool isCaptureName(const std::filesystem::path& path)
+{
+  std::string ext = path.extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(), [] (unsigned char c) { return std::tolower(c); });
+  return ext == ".bin";
+}
+
+static bool isCapture(const std::filesystem::directory_entry& entry)
+{
+  return entry.is_regular_file() && isCaptureName(entry.path());
+}
+
+// Converts one capture, accounting for it in summary. Failures are logged, not thrown.
+static bool convertCounted(const std::filesystem::path& in, const std::filesystem::path& out, uint64_t size,
+  const conversion_options_t& conversion, ThreadPool& pool, batch_summary_t& summary, std::mutex& m)
+{
+  try {
+    convertCapture(in, out, conversion, pool);
+
+    std::error_code ec;
+    const uint64_t out_size = std::filesystem::file_size(out, ec);
+
+    std::lock_guard lock(m);
+    summary.converted++;
+    summary.input_bytes += size;
+    summary.output_bytes += out_size;
+    return true;
+  } catch (const std::exception& e) {
+    spdlog::error("{}: {}", in.string(), e.what());
+
+    std::lock_guard lock(m);
+    summary.failed++;
+    return false;
+  }
+}
+
+// Options of each of parallel_files captures converted at once on a pool of workers threads.
+// The process and the pool are set aside once out of the memory budget, each capture in flight
+// gets an equal share of the rest for its members.
+static conversion_options_t shareMemoryBudget(conversion_options_t conversion, size_t parallel_files, size_t workers)
+{
+  if (conversion.max_memory == 0)
+    return conversion;
+
+  const size_t reserved = reservedMemory(workers);
+  const size_t members_memory = conversion.max_memory > reserved ? conversion.max_memory - reserved : 0;
+
+  // At least a byte: 0 would lift the limit
+  conversion.max_memory = std::max<size_t>(members_memory / parallel_files, 1);
+  conversion.members_memory_only = true;
+
+  return conversion;
+}
+
+std::vector<std::filesystem::path> expandInputs(const std::vector<std::string>& args)
+{
+  std::vector<std::filesystem::path> inputs;
+
+  for (const auto& arg : args)
+  {
+    std::vector<std::filesystem::path> matches;
+
+    if (std::filesystem::is_directory(arg))
+    {
+      for (const auto& entry : std::filesystem::directory_iterator(arg))
+        if (isCapture(entry))
+          matches.push_back(entry.path());
+    }
+    else if (std::filesystem::exists(arg))
+    {
+      matches.push_back(arg);
+    }
+    else if (arg.find_first_of("*?[") != std::string::npos)
+    {
+      // Patterns the shell did not expand, quoted or too long for the command line
+      glob_t g;
+      if (glob(arg.c_str(), 0, NULL, &g) == 0)
+      {
+        for (size_t i = 0; i < g.gl_pathc; i++)
+          if (isCapture(std::filesystem::directory_entry(g.gl_pathv[i])))
+            matches.push_back(g.gl_pathv[i]);
+      }
+      globfree(&g);
+    }
+
+    if (matches.empty())
+      throw std::runtime_error("No capture found for " + arg);
+
+    std::sort(matches.begin(), matches.end());
+    inputs.insert(inputs.end(), matches.begin(), matches.end());
+  }
+
+  // A capture named twice is converted once
+  std::set<std::filesystem::path> seen;
+  std::erase_if(inputs, [&seen] (const auto& p) { return !seen.insert(std::filesystem::weakly_canonical(p)).second; });
+
+  return inputs;
+}
+
+std::filesystem::path outputPath(const std::filesystem::path& in_path, const std::filesystem::path& output_dir)
+{
+  // Default output folder is same as input
+  std::filesystem::path out_path = output_dir.empty() ? in_path.parent_path() : output_dir;
+  out_path /= in_path.stem();
+  out_path += ".srzip";
+  return out_path;
+}
+
+batch_summary_t convertBatch(std::vector<std::filesystem::path> inputs, const batch_options_t& options)
+{
+  const auto started = clock_type::now();
+
+  struct job_t {
+    std::filesystem::path in;
+    std::filesystem::path out;
+    uint64_t size;
+  };
+
+  batch_summary_t summary;
+
+  std::vector<job_t> jobs;
+  std::set<std::filesystem::path> outputs;
+  for (const auto& in : inputs)
+  {
+    job_t job{ in, outputPath(in, options.output_dir), 0 };
+
+    std::error_code ec;
+    job.size = std::filesystem::file_size(in, ec);
+
+    // Captures with the same name in different folders would overwrite each other's archive
+    if (!outputs.insert(job.out).second)
+    {
+      spdlog::error("{}: {} is already the output of another capture", in.string(), job.out.string());
+      summary.failed++;
+      continue;
+    }
+
+    jobs.push_back(std::move(job));
+  }
+
+  std::stable_sort(jobs.begin(), jobs.end(), [] (const job_t& a, const job_t& b) { return a.size > b.size; });
+
+  const size_t parallel_files = std::clamp<size_t>(options.parallel_files, 1, std::max<size_t>(jobs.size(), 1));
+
+  ThreadPool pool(options.conversion.jobs);
+
+  const conversion_options_t conversion = shareMemoryBudget(options.conversion, parallel_files, pool.size());
+
+  std::atomic<size_t> next = 0;
+  std::mutex m;
+
+  auto convert_files = [&] {
+    for (size_t i = next++; i < jobs.size(); i = next++)
+    {
+      const auto& job = jobs[i];
+      spdlog::info("Converting {} ({}/{})", job.in.string(), i + 1, jobs.size());
+
+      convertCounted(job.in, job.out, job.size, conversion, pool, summary, m);
+    }
+  };
+
+  std::vector<std::thread> files;
+  for (size_t f = 1; f < parallel_files; f++)
+    files.emplace_back(convert_files);
+  convert_files();
+
+  for (auto& t : files)
+    t.join();
+
+  summary.seconds = std::chrono::duration<double>(clock_type::now() - started).count();
+
+  return summary;
+}
+
+batch_summary_t watchFolder(FolderWatcher& watcher, const batch_options_t& options)
+{
+  const auto started = clock_type::now();
+
+  const size_t parallel_files = std::max<size_t>(options.parallel_files, 1);
+
+  batch_summary_t summary;
+  std::mutex m;
+
+  // Created once: threads and their conversion buffers are ready when the next capture lands
+  ThreadPool pool(options.conversion.jobs);
+
+  const conversion_options_t conversion = shareMemoryBudget(options.conversion, parallel_files, pool.size());
+
+  // Captures waiting for a converter: saving a file again before its turn does not queue it twice
+  BoundedQueue<std::filesystem::path> queue(BATCH_WATCH_QUEUE);
+  std::set<std::filesystem::path> waiting;
+
+  auto convert_files = [&] {
+    while (auto in = queue.pop())
+    {
+      {
+        std::lock_guard lock(m);
+        waiting.erase(*in);
+      }
+
+      std::error_code ec;
+      const uint64_t size = std::filesystem::file_size(*in, ec);
+      if (ec)
+      {
+        // Deleted or renamed again before its turn
+        spdlog::warn("{} vanished before conversion", in->string());
+        continue;
+      }
+
+      const auto out = outputPath(*in, options.output_dir);
+      spdlog::info("Converting {}", in->string());
+
+      const auto t = clock_type::now();
+      if (convertCounted(*in, out, size, conversion, pool, summary, m))
+        spdlog::info("{} ready in {:.2f} s", out.string(), std::chrono::duration<double>(clock_type::now() - t).count());
+    }
+  };
+
+  std::vector<std::thread> files;
+  for (size_t f = 0; f < parallel_files; f++)
+    files.emplace_back(convert_files);
+
+  // Captures already seen are still converted once the watch stops
+  auto finish_files = [&] {
+    queue.close();
+    for (auto& t : files)
+      t.join();
+  };
+
+  // After an event queue overflow, the captures whose archive is missing or older are converted
+  auto unconverted = [&options] (const std::filesystem::path& in) {
+    std::error_code ec;
+    const auto converted = std::filesystem::last_write_time(outputPath(in, options.output_dir), ec);
+    return ec || converted < std::filesystem::last_write_time(in, ec);
+  };
+
+  spdlog::info("Watching {} for captures", watcher.folder().string());
+
+  try {
+    for (auto completed = watcher.wait(unconverted); !completed.empty(); completed = watcher.wait(unconverted))
+      for (auto& in : completed)
+      {
+        {
+          std::lock_guard lock(m);
+          if (!waiting.insert(in).second)
+            continue;
+        }
+        queue.push(std::move(in));
+      }
+  } catch (...) {
+    finish_files();
+    throw;
+  }
+
+  finish_files();
+
+  summary.seconds = std::chrono::duration<double>(clock_type::now() - started).count();
+
+  return summary;
+}
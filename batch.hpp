@@ -0,0 +1,61 @@
+#ifndef BATCH_HPP_
+#define BATCH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "conversion.hpp"
+
+class FolderWatcher;
+
+// Default number of captures converted at once: one finishing while the next one starts
+const size_t BATCH_PARALLEL_FILES = 2;
+
+// Captures a watched folder may have waiting for conversion before events are left unread
+const size_t BATCH_WATCH_QUEUE = 1024;
+
+struct batch_options_t {
+  // Applies to every capture; jobs is the size of the pool they share,
+  // max_memory the budget of the whole batch
+  conversion_options_t conversion;
+
+  // Output folder, next to each capture when empty
+  std::filesystem::path output_dir;
+
+  // Captures converted at once
+  size_t parallel_files = BATCH_PARALLEL_FILES;
+};
+
+struct batch_summary_t {
+  size_t converted = 0;
+  size_t failed = 0;
+
+  uint64_t input_bytes = 0;
+  uint64_t output_bytes = 0;
+
+  double seconds = 0;
+};
+
+// Whether path is named like a capture (.bin extension, any case)
+bool isCaptureName(const std::filesystem::path& path);
+
+// Captures named by args: files as they are, the .bin files of directories, glob patterns expanded.
+// Throws if an argument names no capture.
+std::vector<std::filesystem::path> expandInputs(const std::vector<std::string>& args);
+
+// Archive a capture is converted into: same name with the .srzip extension, in output_dir if given
+std::filesystem::path outputPath(const std::filesystem::path& in_path, const std::filesystem::path& output_dir);
+
+// Converts every capture, largest first so that the last ones to finish are short.
+// Several captures are converted at once, their members sharing one thread pool.
+// Failures are logged and counted, the other captures are still converted.
+batch_summary_t convertBatch(std::vector<std::filesystem::path> inputs, const batch_options_t& options);
+
+// Converts every capture completed in the watched folder, as soon as it is, until the watcher is stopped.
+// The pool and conversion buffers stay warm between captures. Captures already seen are converted before returning.
+batch_summary_t watchFolder(FolderWatcher& watcher, const batch_options_t& options);
+
+#endif // BATCH_HPP_
@@ -0,0 +1,320 @@
+#include "capture_index.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <type_traits>
+
+#include <sys/stat.h>
+
+#include <spdlog/spdlog.h>
+
+// Records are read in place from the mapping: the file layout is the in-memory layout
+static_assert(std::endian::native == std::endian::little, "Capture indexes are little-endian");
+static_assert(std::is_trivially_copyable_v<index_record_t> && std::is_standard_layout_v<index_record_t>);
+static_assert(sizeof(index_file_header_t) == 32);
+static_assert(sizeof(index_record_t) == 176);
+static_assert(sizeof(index_file_header_t) % alignof(index_record_t) == 0);
+
+static const char INDEX_MAGIC[8] = { 'S', 'B', '2', 'S', 'R', 'I', 'D', 'X' };
+
+// Key of every entry: the same capture named from another folder is the same entry
+static std::string normalized(const std::filesystem::path& path)
+{
+  return std::filesystem::absolute(path).lexically_normal().string();
+}
+
+CaptureIndex::CaptureIndex(const std::filesystem::path& filename)
+: filename(filename)
+{
+  load();
+}
+
+void CaptureIndex::load()
+{
+  entries = {};
+  strings = {};
+  discarded = false;
+  file.close();
+
+  if (!std::filesystem::exists(filename))
+    return;
+
+  file.open(filename);
+  const auto data = file.data();
+
+  index_file_header_t header;
+  if (data.size() < sizeof(header))
+    throw std::runtime_error(filename.string() + " is not a capture index");
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+    throw std::runtime_error(filename.string() + " is not a capture index");
+
+  if (header.version != INDEX_VERSION || header.record_size != sizeof(index_record_t))
+  {
+    spdlog::warn("{}: index version {} instead of {}, it is rebuilt from the captures given", filename.string(), header.version, INDEX_VERSION);
+    file.close();
+    discarded = true;
+    return;
+  }
+
+  const uint64_t records_size = header.count * sizeof(index_record_t);
+  if (header.count > data.size() / sizeof(index_record_t) ||
+      sizeof(header) + records_size + header.strings_size != data.size())
+    throw std::runtime_error("Corrupted capture index " + filename.string());
+
+  entries = { reinterpret_cast<const index_record_t*>(data.data() + sizeof(header)), size_t(header.count) };
+  strings = { reinterpret_cast<const char*>(data.data() + sizeof(header) + records_size), size_t(header.strings_size) };
+
+  for (const auto& record : entries)
+    if (record.path_offset > strings.size() || record.path_size > strings.size() - record.path_offset ||
+        record.notes_offset > strings.size() || record.notes_size > strings.size() - record.notes_offset)
+      throw std::runtime_error("Corrupted capture index " + filename.string());
+}
+
+std::string_view CaptureIndex::path(const index_record_t& record) const
+{
+  return strings.substr(record.path_offset, record.path_size);
+}
+
+std::string_view CaptureIndex::notes(const index_record_t& record) const
+{
+  return strings.substr(record.notes_offset, record.notes_size);
+}
+
+const index_record_t* CaptureIndex::find(std::string_view key) const
+{
+  auto it = std::lower_bound(entries.begin(), entries.end(), key,
+    [this] (const index_record_t& record, std::string_view k) { return path(record) < k; });
+
+  return it != entries.end() && path(*it) == key ? &*it : nullptr;
+}
+
+capture_info_t CaptureIndex::info(const index_record_t& record) const
+{
+  capture_info_t info;
+  info.path = std::string(path(record));
+  info.size = record.size;
+
+  if (record.flags & INDEX_ERROR)
+  {
+    info.error = notes(record);
+    return info;
+  }
+
+  if (record.flags & INDEX_SUSPICIOUS)
+    info.problems.emplace_back(notes(record));
+
+  // Magnitudes and units are not indexed: values are kept in base units, as the oscilloscope writes them
+  header_t& h = info.header;
+  auto value = [] (double v) { return header_t::unit_value_t{ v, magnitude_t::IU, unit_t::NUL }; };
+
+  for (size_t c = 0; c < MAX_ANALOG_CHANNELS; c++)
+  {
+    h.analog_ch_on[c] = record.analog_on & (1u << c);
+    h.analog_scales[c] = value(record.analog_scale[c]);
+    h.analog_offsets[c] = value(record.analog_offset[c]);
+  }
+
+  h.digital_on = record.flags & INDEX_DIGITAL_ON;
+  for (size_t p = 0; p < MAX_DIGITAL_PROBES; p++)
+    h.digital_ch_on[p] = (record.digital_ch_on >> p) & 1;
+
+  h.time_div = value(record.time_div);
+  h.time_delay = value(record.time_delay);
+  h.analog_size = record.analog_size;
+  h.analog_sample_rate = value(record.analog_sample_rate);
+  h.digital_size = record.digital_size;
+  h.digital_sample_rate = value(record.digital_sample_rate);
+
+  return info;
+}
+
+// Record of a freshly read capture, its strings appended to the table
+static index_record_t make_record(const capture_info_t& info, uint64_t size, int64_t mtime_ns, std::string& strings)
+{
+  index_record_t record = {};
+  record.size = size;
+  record.mtime_ns = mtime_ns;
+
+  std::string notes;
+  if (!info.error.empty())
+  {
+    record.flags |= INDEX_ERROR;
+    notes = info.error;
+  }
+  else
+  {
+    const header_t& h = info.header;
+
+    for (size_t c = 0; c < MAX_ANALOG_CHANNELS; c++)
+    {
+      record.analog_on |= uint32_t(h.analog_ch_on[c]) << c;
+      record.analog_scale[c] = h.analog_scales[c].value;
+      record.analog_offset[c] = h.analog_offsets[c].value;
+    }
+
+    if (h.digital_on)
+    {
+      record.flags |= INDEX_DIGITAL_ON;
+      for (size_t p = 0; p < MAX_DIGITAL_PROBES; p++)
+        record.digital_ch_on |= uint32_t(h.digital_ch_on[p] != 0) << p;
+    }
+
+    record.analog_size = h.analog_size;
+    record.digital_size = h.digital_size;
+    record.analog_sample_rate = h.analog_sample_rate.value;
+    record.digital_sample_rate = h.digital_sample_rate.value;
+    record.time_div = h.time_div.value;
+    record.time_delay = h.time_delay.value;
+    record.duration = captureDuration(h);
+    record.sample_rate = h.digital_on ? h.digital_sample_rate.value : h.analog_sample_rate.value;
+
+    for (const auto& problem : info.problems)
+      notes += (notes.empty() ? "" : "; ") + problem;
+    if (!notes.empty())
+      record.flags |= INDEX_SUSPICIOUS;
+  }
+
+  record.path_offset = strings.size();
+  record.path_size = info.path.string().size();
+  strings += info.path.string();
+
+  record.notes_offset = strings.size();
+  record.notes_size = notes.size();
+  strings += notes;
+
+  return record;
+}
+
+index_update_t CaptureIndex::update(const std::vector<std::filesystem::path>& inputs, size_t jobs)
+{
+  // Refreshing nothing would replace the old index with an empty one, losing its paths
+  if (discarded && inputs.empty())
+    throw std::runtime_error(filename.string() + ": index version changed, re-run with the capture folders");
+
+  index_update_t stats;
+
+  // Every capture indexed or given, once
+  std::set<std::string> paths;
+  for (const auto& record : entries)
+    paths.emplace(path(record));
+  for (const auto& input : inputs)
+    paths.insert(normalized(input));
+
+  struct entry_t {
+    std::string path;
+    uint64_t size;
+    int64_t mtime_ns;
+    // Indexed and unchanged
+    const index_record_t* current;
+  };
+
+  std::vector<entry_t> kept;
+  std::vector<std::filesystem::path> to_scan;
+
+  for (const auto& p : paths)
+  {
+    const index_record_t* record = find(p);
+
+    struct stat st;
+    if (stat(p.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+    {
+      if (record)
+        stats.removed++;
+      continue;
+    }
+
+    const int64_t mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+    if (!record || record->size != uint64_t(st.st_size) || record->mtime_ns != mtime_ns)
+    {
+      record = nullptr;
+      to_scan.push_back(p);
+    }
+
+    kept.push_back({ p, uint64_t(st.st_size), mtime_ns, record });
+  }
+
+  const auto infos = scanCaptures(to_scan, jobs);
+  stats.scanned = infos.size();
+  stats.unchanged = kept.size() - infos.size();
+
+  // Both in path order: scanned captures come back in the order of kept
+  std::vector<index_record_t> records;
+  std::string table;
+  records.reserve(kept.size());
+
+  for (size_t i = 0, scanned = 0; i < kept.size(); i++)
+  {
+    const auto& entry = kept[i];
+
+    if (entry.current)
+    {
+      // Copied as is, only its strings move
+      index_record_t record = *entry.current;
+      record.path_offset = table.size();
+      table += path(*entry.current);
+      record.notes_offset = table.size();
+      table += notes(*entry.current);
+      records.push_back(record);
+    }
+    else
+    {
+      records.push_back(make_record(infos[scanned++], entry.size, entry.mtime_ns, table));
+    }
+  }
+
+  index_file_header_t header = {};
+  std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  header.version = INDEX_VERSION;
+  header.record_size = sizeof(index_record_t);
+  header.count = records.size();
+  header.strings_size = table.size();
+
+  // Written aside, then renamed over: readers never see a partial index
+  const std::filesystem::path tmp = filename.string() + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(index_record_t));
+    out.write(table.data(), table.size());
+    out.close();
+
+    if (!out)
+    {
+      std::filesystem::remove(tmp);
+      throw std::runtime_error("Failed writing " + filename.string());
+    }
+  }
+  std::filesystem::rename(tmp, filename);
+
+  load();
+
+  return stats;
+}
+
+std::vector<const index_record_t*> CaptureIndex::query(const index_query_t& query) const
+{
+  std::vector<const index_record_t*> matches;
+
+  for (const auto& record : entries)
+  {
+    if (record.flags & INDEX_ERROR)
+      continue;
+    if (record.sample_rate < query.min_sample_rate || record.sample_rate > query.max_sample_rate)
+      continue;
+    if ((record.analog_on & query.analog_channels) != query.analog_channels)
+      continue;
+    if (query.digital && !(record.flags & INDEX_DIGITAL_ON))
+      continue;
+
+    matches.push_back(&record);
+  }
+
+  return matches;
+}
@@ -0,0 +1,148 @@
+#ifndef CAPTURE_INDEX_HPP_
+#define CAPTURE_INDEX_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "info.hpp"
+#include "mapped_file.hpp"
+
+// Index file used when none is given, in the current folder
+const char* const INDEX_DEFAULT_FILE = "siglent-bin2sr.idx";
+
+// Bumped whenever the layout below changes: older indexes are rebuilt, not misread
+const uint32_t INDEX_VERSION = 1;
+
+// Index files are, in this order, little-endian:
+// - index_file_header_t
+// - count index_record_t, sorted by path
+// - the string table: paths and notes, referenced by offset from the records
+// so that a mapped index is searched and read in place.
+struct index_file_header_t {
+  // "SB2SRIDX"
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t count;
+  uint64_t strings_size;
+};
+
+// index_record_t::flags
+const uint32_t INDEX_DIGITAL_ON = 1 << 0;
+// Header values no oscilloscope writes: notes describes them
+const uint32_t INDEX_SUSPICIOUS = 1 << 1;
+// Header could not be read: notes holds the error
+const uint32_t INDEX_ERROR = 1 << 2;
+
+// One capture: the key (path, size, modification time), its decoded header fields and derived values
+struct index_record_t {
+  uint64_t path_offset;
+  uint32_t path_size;
+  uint32_t flags;
+
+  uint64_t size;
+  int64_t mtime_ns;
+
+  // Bit c for channel c + 1
+  uint32_t analog_on;
+  // Bit p for probe p + 1
+  uint32_t digital_ch_on;
+
+  uint32_t analog_size;
+  uint32_t digital_size;
+
+  double analog_sample_rate;
+  double digital_sample_rate;
+  double time_div;
+  double time_delay;
+  double analog_scale[MAX_ANALOG_CHANNELS];
+  double analog_offset[MAX_ANALOG_CHANNELS];
+
+  // Derived: seconds of signal, see captureDuration
+  double duration;
+  // Derived: sample rate of the capture timebase, digital when logic probes are on
+  double sample_rate;
+
+  uint64_t notes_offset;
+  uint32_t notes_size;
+  uint32_t reserved;
+};
+
+struct index_query_t {
+  // Sample rate of the capture timebase, inclusive bounds
+  double min_sample_rate = 0;
+  double max_sample_rate = std::numeric_limits<double>::infinity();
+
+  // Channels that must be on, bit c for channel c + 1
+  uint32_t analog_channels = 0;
+
+  // Logic probes must be on
+  bool digital = false;
+
+  // Captures whose header could not be read are never selected
+};
+
+struct index_update_t {
+  // Entries reused as they were
+  size_t unchanged = 0;
+  // Headers read: new captures, or changed since last indexed
+  size_t scanned = 0;
+  // Entries dropped, their file gone
+  size_t removed = 0;
+};
+
+// Persistent index of capture headers, keyed by path, size and modification time.
+// The index file is mapped: lookups and queries read it in place, without parsing it first.
+class CaptureIndex
+{
+  public:
+
+    // Opens the index file if there is one; an index of another version is empty, to be rebuilt
+    // from the captures given to update. Throws if the file is not an index.
+    explicit CaptureIndex(const std::filesystem::path& filename);
+
+    size_t size() const { return entries.size(); }
+
+    std::span<const index_record_t> records() const { return entries; }
+
+    // Entry of an absolute, normalized path, nullptr if not indexed
+    const index_record_t* find(std::string_view path) const;
+
+    std::string_view path(const index_record_t& record) const;
+
+    std::string_view notes(const index_record_t& record) const;
+
+    // The entry as a scan would have returned it
+    capture_info_t info(const index_record_t& record) const;
+
+    // Indexes the captures not indexed yet, re-reads those changed since, forgets those gone:
+    // the indexed captures and inputs are all checked, only new or changed headers are read, on jobs threads.
+    // The index file is then replaced. Throws without inputs when the index was of another version.
+    index_update_t update(const std::vector<std::filesystem::path>& inputs, size_t jobs);
+
+    // Entries matching query, in path order
+    std::vector<const index_record_t*> query(const index_query_t& query) const;
+
+  private:
+
+    void load();
+
+    const std::filesystem::path filename;
+
+    MappedFile file;
+
+    std::span<const index_record_t> entries;
+
+    std::string_view strings;
+
+    // The index file is of another version: its entries were dropped
+    bool discarded = false;
+};
+
+#endif // CAPTURE_INDEX_HPP_
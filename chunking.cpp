@@ -0,0 +1,132 @@
+#include "chunking.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+size_t alignChunkSamples(size_t samples, size_t granularity)
+{
+  granularity = std::max<size_t>(granularity, 1);
+  return std::max(samples / granularity, size_t(1)) * granularity;
+}
+
+size_t chooseChunkSamples(const chunk_constraints_t& c)
+{
+  const size_t bytes_per_sample = std::max<size_t>(c.bytes_per_sample, 1);
+
+  size_t chunk = TARGET_MEMBER_BYTES / bytes_per_sample;
+
+  // Enough members to keep every worker busy until the end
+  const size_t wanted_members = std::max<size_t>(c.workers, 1) * MEMBERS_PER_WORKER;
+  chunk = std::min(chunk, (c.samples * std::max<size_t>(c.streams, 1) + wanted_members - 1) / wanted_members);
+
+  // Every member in flight, fully converted, must fit in memory along with its input
+  const size_t in_flight = std::max<size_t>(c.queue_depth, 1);
+  chunk = std::min(chunk, c.memory / (in_flight * (bytes_per_sample + c.input_bytes_per_sample)));
+
+  // No point in members smaller than the capture
+  chunk = std::max(chunk, MIN_CHUNK_SAMPLES);
+  chunk = std::min(chunk, std::max<size_t>(c.samples, 1));
+
+  return alignChunkSamples(chunk, c.granularity);
+}
+
+size_t reservedMemory(size_t workers)
+{
+  return BASE_MEMORY_BYTES + std::max<size_t>(workers, 1) * WORKER_MEMORY_BYTES;
+}
+
+memory_plan_t fitMemoryBudget(chunk_constraints_t c, size_t budget, size_t requested_chunk, std::optional<size_t> reserve)
+{
+  const size_t reserved = reserve.value_or(reservedMemory(c.workers));
+  const size_t members_memory = budget > reserved ? budget - reserved : 0;
+  const size_t member_bytes_per_sample = std::max<size_t>(c.bytes_per_sample, 1) + c.input_bytes_per_sample;
+
+  // Members as large as they would be without a budget, or a quarter of the target size
+  chunk_constraints_t unbounded = c;
+  unbounded.queue_depth = 1;
+  const size_t wanted = std::min(chooseChunkSamples(unbounded), TARGET_MEMBER_BYTES / 4 / std::max<size_t>(c.bytes_per_sample, 1));
+
+  c.memory = std::min(c.memory, members_memory);
+
+  memory_plan_t plan;
+  for (size_t depth = std::max<size_t>(c.queue_depth, 1); depth > 0; depth--)
+  {
+    c.queue_depth = depth;
+
+    plan.queue_depth = depth;
+    plan.chunk_samples = requested_chunk > 0 ? alignChunkSamples(requested_chunk, c.granularity) : chooseChunkSamples(c);
+
+    const bool fits = plan.chunk_samples * member_bytes_per_sample * depth <= members_memory;
+    if (fits && (requested_chunk > 0 || plan.chunk_samples >= wanted))
+      break;
+  }
+
+  plan.peak_bytes = reserved + plan.chunk_samples * member_bytes_per_sample * plan.queue_depth;
+
+  return plan;
+}
+
+size_t parse_memory_size(const std::string& text)
+{
+  size_t end = 0;
+  double value = -1;
+  try {
+    value = std::stod(text, &end);
+  } catch (const std::exception&) {
+  }
+
+  std::string suffix = text.substr(std::min(end, text.size()));
+  if (suffix.size() > 1 && suffix.back() == 'B')
+    suffix.pop_back();
+  if (suffix.size() > 1 && suffix.back() == 'i')
+    suffix.pop_back();
+
+  double scale = 1;
+  if (suffix == "K" || suffix == "k")
+    scale = 1ull << 10;
+  else if (suffix == "M")
+    scale = 1ull << 20;
+  else if (suffix == "G")
+    scale = 1ull << 30;
+  else if (suffix == "T")
+    scale = 1ull << 40;
+  else if (!suffix.empty() && suffix != "B")
+    value = -1;
+
+  // Less than a byte would read as no limit, SIZE_MAX and above do not convert
+  const double bytes = value * scale;
+  if (!(value > 0) || !(bytes >= 1) || bytes >= double(SIZE_MAX))
+    throw std::runtime_error("Invalid memory size " + text + ", expected a number of bytes with an optional K, M, G or T suffix");
+
+  return size_t(bytes);
+}
+
+size_t peakResidentMemory()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) < 0)
+    return 0;
+
+  // Kilobytes on Linux
+  return size_t(usage.ru_maxrss) * 1024;
+}
+
+size_t availableMemory()
+{
+  const long pages = sysconf(_SC_AVPHYS_PAGES);
+  const long page_size = sysconf(_SC_PAGESIZE);
+
+  if (pages > 0 && page_size > 0)
+    return size_t(pages) * size_t(page_size);
+
+  const long total = sysconf(_SC_PHYS_PAGES);
+  if (total > 0 && page_size > 0)
+    return size_t(total) * size_t(page_size) / 2;
+
+  // Unknown: assume a small machine
+  return size_t(1) << 30;
+}
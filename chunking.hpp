@@ -0,0 +1,87 @@
+#ifndef CHUNKING_HPP_
+#define CHUNKING_HPP_
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+// Converted size of a member the adaptive chunk size aims at.
+// Large enough for per-member costs (headers, compressor reset, scheduling) to vanish,
+// small enough for several members per channel to be converted concurrently.
+const size_t TARGET_MEMBER_BYTES = 10 << 20;
+
+// Chunks never get smaller than this many samples, whatever the other constraints
+const size_t MIN_CHUNK_SAMPLES = 0x10000;
+
+// Members each worker should get, so that the last ones do not leave workers idle
+const size_t MEMBERS_PER_WORKER = 4;
+
+// Memory a worker uses beside its member: conversion block, deflate state (level 9 window and hash chains)
+const size_t WORKER_MEMORY_BYTES = (1 << 20) + (384 << 10);
+
+// Memory the process uses beside the pipeline: code, libraries, stacks, logging
+const size_t BASE_MEMORY_BYTES = 16 << 20;
+
+// What the chunk size of a capture depends on.
+// Samples are counted on the member timebase: analog samples once replicated to the digital rate.
+struct chunk_constraints_t {
+  // Samples of each channel
+  size_t samples;
+
+  // Channels split into members (analog channels, plus one for all logic probes)
+  size_t streams;
+
+  // Converted bytes per sample of the widest member
+  size_t bytes_per_sample;
+
+  // Capture bytes per sample the widest member is converted from, resident while it is in flight
+  size_t input_bytes_per_sample = 0;
+
+  // Chunk sizes are a multiple of this
+  size_t granularity = 1;
+
+  size_t workers = 1;
+
+  // Members in flight at once, being converted or waiting for the writer
+  size_t queue_depth = 1;
+
+  // Bytes in flight members may use
+  size_t memory;
+};
+
+// Samples per member meeting the constraints as well as possible
+size_t chooseChunkSamples(const chunk_constraints_t& constraints);
+
+struct memory_plan_t {
+  size_t chunk_samples;
+
+  size_t queue_depth;
+
+  // Expected peak memory of the conversion
+  size_t peak_bytes;
+};
+
+// Memory used beside the members: the process itself and a pool of workers threads
+size_t reservedMemory(size_t workers);
+
+// Fits the conversion in budget bytes: the queue is shortened first, as long as members keep a quarter
+// of the target size, then chunks shrink. A requested chunk size (non zero) is kept as is.
+// reserved is set aside out of budget first, reservedMemory(constraints.workers) when not given:
+// conversions sharing a process and a pool get 0, the caller having set it aside once for all of them.
+// peak_bytes exceeds budget when even the smallest settings do not fit.
+memory_plan_t fitMemoryBudget(chunk_constraints_t constraints, size_t budget, size_t requested_chunk = 0,
+  std::optional<size_t> reserved = std::nullopt);
+
+// Parses a byte count with an optional binary suffix: 512M, 2G, 1.5GiB... throws on anything else
+size_t parse_memory_size(const std::string& text);
+
+// Largest resident set size the process had so far
+size_t peakResidentMemory();
+
+// Rounds a requested chunk size to the granularity, at least one granule
+size_t alignChunkSamples(size_t samples, size_t granularity);
+
+// Physical memory currently free, or half of the total when the system does not tell
+size_t availableMemory();
+
+#endif // CHUNKING_HPP_
@@ -0,0 +1,155 @@
+#include "compression.hpp"
+#include "crc32.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <zlib.h>
+
+compression_t parse_compression(const std::string& name)
+{
+  for (auto c : { compression_t::STORE, compression_t::FAST, compression_t::DEFAULT, compression_t::BEST })
+    if (name == to_string(c))
+      return c;
+
+  throw std::runtime_error("Unknown compression " + name + ", expected store, fast, default or best");
+}
+
+const char* to_string(compression_t compression)
+{
+  switch (compression)
+  {
+    case compression_t::STORE: return "store";
+    case compression_t::FAST: return "fast";
+    case compression_t::DEFAULT: return "default";
+    case compression_t::BEST: return "best";
+  }
+  return "";
+}
+
+static int deflate_level(compression_t compression)
+{
+  switch (compression)
+  {
+    case compression_t::FAST: return 1;
+    case compression_t::BEST: return 9;
+    default: return 6;
+  }
+}
+
+struct MemberCompressor::state_t {
+  z_stream z;
+};
+
+MemberCompressor::MemberCompressor()
+: state(std::make_unique<state_t>()),
+compression(compression_t::DEFAULT)
+{
+  state->z = {};
+
+  // Negative window bits: raw deflate stream, without zlib header and trailer
+  if (deflateInit2(&state->z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    throw std::runtime_error("Failed initializing deflate");
+}
+
+MemberCompressor::~MemberCompressor()
+{
+  deflateEnd(&state->z);
+}
+
+void MemberCompressor::begin(size_t size_hint, compression_t compression)
+{
+  this->compression = compression;
+
+  out = {};
+  out.crc = 0;
+
+  if (compression == compression_t::STORE)
+  {
+    out.method = ZIP_METHOD_STORE;
+    out.data.reserve(size_hint);
+    return;
+  }
+
+  // Changing parameters before any input is fed never produces output
+  deflateReset(&state->z);
+  deflateParams(&state->z, deflate_level(compression), Z_DEFAULT_STRATEGY);
+
+  out.method = ZIP_METHOD_DEFLATE;
+
+  // Samples usually compress well: start small, grow on demand
+  out.data.resize(std::max<size_t>(size_hint / 4, 4096));
+
+  state->z.next_out = reinterpret_cast<Bytef*>(out.data.data());
+  state->z.avail_out = out.data.size();
+}
+
+void MemberCompressor::deflate_step(int flush)
+{
+  auto& z = state->z;
+
+  for (;;)
+  {
+    const size_t produced = out.data.size() - z.avail_out;
+    if (z.avail_out == 0)
+    {
+      out.data.resize(out.data.size() * 2);
+      z.next_out = reinterpret_cast<Bytef*>(out.data.data() + produced);
+      z.avail_out = out.data.size() - produced;
+    }
+
+    int ret = deflate(&z, flush);
+
+    if (ret == Z_STREAM_END)
+      return;
+
+    if (ret != Z_OK && ret != Z_BUF_ERROR)
+      throw std::runtime_error("Failed compressing member");
+
+    // Without finishing, deflate is done once it has consumed everything and still has room
+    if (flush == Z_NO_FLUSH && z.avail_in == 0 && z.avail_out > 0)
+      return;
+  }
+}
+
+void MemberCompressor::update(std::span<const std::byte> data)
+{
+  auto& z = state->z;
+
+  out.crc = crc32_update(out.crc, data);
+  out.size += data.size();
+
+  if (compression == compression_t::STORE)
+  {
+    out.data.insert(out.data.end(), data.begin(), data.end());
+    return;
+  }
+
+  if (z.next_out == Z_NULL)
+    throw std::runtime_error("Compressor not started");
+
+  z.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(data.data()));
+  z.avail_in = data.size();
+
+  deflate_step(Z_NO_FLUSH);
+}
+
+compressed_member_t MemberCompressor::finish()
+{
+  auto& z = state->z;
+
+  if (compression == compression_t::STORE)
+    return std::move(out);
+
+  z.next_in = Z_NULL;
+  z.avail_in = 0;
+
+  deflate_step(Z_FINISH);
+
+  out.data.resize(out.data.size() - z.avail_out);
+
+  z.next_out = Z_NULL;
+  z.avail_out = 0;
+
+  return std::move(out);
+}
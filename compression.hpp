@@ -0,0 +1,78 @@
+#ifndef COMPRESSION_HPP_
+#define COMPRESSION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// ZIP compression method identifiers
+const uint16_t ZIP_METHOD_STORE = 0;
+const uint16_t ZIP_METHOD_DEFLATE = 8;
+
+// How hard archive members are compressed
+enum class compression_t {
+  // No compression, members are stored: conversion runs at disk speed
+  STORE,
+  // Deflate level 1
+  FAST,
+  // Deflate level 6
+  DEFAULT,
+  // Deflate level 9
+  BEST
+};
+
+// Parses store|fast|default|best, throws on anything else
+compression_t parse_compression(const std::string& name);
+
+const char* to_string(compression_t compression);
+
+// Archive member compressed ahead of time, ready to be copied as is into the archive
+struct compressed_member_t {
+  uint16_t method;
+
+  // CRC-32 of the uncompressed data
+  uint32_t crc;
+
+  // Uncompressed size
+  size_t size;
+
+  std::vector<std::byte> data;
+};
+
+// Compresses one member at a time into raw deflate data (as stored in ZIP archives),
+// checksumming the uncompressed data on the way.
+class MemberCompressor
+{
+  public:
+
+    MemberCompressor();
+
+    MemberCompressor(const MemberCompressor&) = delete;
+    MemberCompressor& operator=(const MemberCompressor&) = delete;
+
+    ~MemberCompressor();
+
+    // size_hint: expected uncompressed size, to size the output buffer
+    void begin(size_t size_hint, compression_t compression = compression_t::DEFAULT);
+
+    void update(std::span<const std::byte> data);
+
+    compressed_member_t finish();
+
+  private:
+
+    void deflate_step(int flush);
+
+    struct state_t;
+
+    std::unique_ptr<state_t> state;
+
+    compression_t compression;
+
+    compressed_member_t out;
+};
+
+#endif // COMPRESSION_HPP_
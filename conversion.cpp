@@ -0,0 +1,242 @@
+#include "conversion.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "siglent_bin.hpp"
+#include "siglent_data.hpp"
+#include "srzip.hpp"
+#include "analog_convert.hpp"
+#include "member_stream.hpp"
+#include "pipeline.hpp"
+#include "chunking.hpp"
+#include "srzip_writer.hpp"
+#include "time_window.hpp"
+
+void convertCapture(const std::filesystem::path& in_path, const std::filesystem::path& out_path, const conversion_options_t& options)
+{
+  ThreadPool pool(options.jobs);
+  convertCapture(in_path, out_path, options, pool);
+}
+
+void convertCapture(const std::filesystem::path& in_path, const std::filesystem::path& out_path, const conversion_options_t& options, ThreadPool& pool)
+{
+  // Input is mapped once: the header and every reader share the mapping
+  auto file = std::make_shared<const MappedFile>(in_path);
+
+  // Parse header, else error
+  header_t header = parse(*file);
+
+  // Debugging informations
+  spdlog::info("Parsed header");
+  for (const auto& problem : validate_header(file->data()))
+    spdlog::warn("Suspicious header: {}", problem);
+  spdlog::trace("Header fields:\n{}", dump_header(file->data()));
+  spdlog::trace("Active analog channels: {}", std::count(header.analog_ch_on.begin(), header.analog_ch_on.end(), true) );
+  spdlog::trace("Analog sample rate: {}", header.analog_sample_rate.get_value());
+  spdlog::trace("Analog size: {}", header.analog_size);
+  if (header.digital_on) {
+    spdlog::trace("Active digital channels: {}", std::count(header.digital_ch_on.begin(), header.digital_ch_on.end(), true));
+    spdlog::trace("Digital sample rate: {}", header.digital_sample_rate.get_value());
+    spdlog::trace("Digital size: {}", header.digital_size);
+  }
+
+  // Fetch channels labels from header, counting the active ones
+  const std::vector<std::string> analog_labels =
+    getAnalogLabes(header);
+  const std::vector<std::string> digital_labels =
+    getDigitalLabes(header);
+
+  // Assumption: on siglent oscilloscope, digital probes have higher sample rate than analog ones.
+  // If digital enabled, analog may require oversampling. Add some replicas to have equal amount of samples
+  // between analog and digital channels.
+  // Fewer logic samples than analog ones would make no replica at all, and a zero oversampling factor
+  if (header.digital_on && header.digital_size < header.analog_size)
+    throw std::runtime_error("Digital size " + std::to_string(header.digital_size) + " smaller than analog size " +
+      std::to_string(header.analog_size));
+
+  size_t oversample_factor = 1;
+  if (header.digital_on && header.analog_size > 0)
+    oversample_factor = header.digital_size / header.analog_size;
+
+  // Members hold chunk_samples samples on the digital timebase: analog chunks are chunk_samples / oversample_factor
+  // samples before replication, logic chunks are whole octets of the probe planes.
+  const size_t analog_channels = analog_labels.size();
+  const size_t granularity = std::lcm<size_t>(8, oversample_factor);
+
+  // Samples converted on the digital timebase (the analog one without logic probes): all of them,
+  // or those of the time window, wherever they start and end
+  const size_t analog_total = size_t(header.analog_size) * oversample_factor;
+  const size_t digital_total = header.digital_on ? header.digital_size / 8 * 8 : 0;
+
+  sample_range_t window{ 0, std::max(analog_total, digital_total) };
+  if (std::isfinite(options.from) || std::isfinite(options.to))
+  {
+    const double rate = header.digital_on ? header.digital_sample_rate.value : header.analog_sample_rate.value;
+    window = timeWindow(header, rate, window.end, options.from, options.to);
+
+    spdlog::info("Time window: samples {} to {} of {} ({:.9g} s to {:.9g} s from the trigger)",
+      window.begin, window.end, std::max(analog_total, digital_total),
+      captureStartTime(header) + window.begin / rate, captureStartTime(header) + window.end / rate);
+  }
+
+  chunk_constraints_t constraints;
+  constraints.samples = window.size();
+  constraints.streams = analog_channels + (header.digital_on ? 1 : 0);
+  constraints.bytes_per_sample = analog_channels > 0 ? sizeof(float) : sizeof(uint16_t);
+  // Analog: at most one capture byte per sample, logic: one bit per probe
+  constraints.input_bytes_per_sample = std::max<size_t>(analog_channels > 0 ? 1 : 0, (digital_labels.size() + 7) / 8);
+  constraints.granularity = granularity;
+  constraints.workers = pool.size();
+  constraints.queue_depth = options.queue_depth;
+  // Leave room for the page cache the capture is read through
+  constraints.memory = availableMemory() / 2;
+
+  size_t chunk_samples;
+  size_t queue_depth = options.queue_depth;
+
+  if (options.max_memory > 0)
+  {
+    const memory_plan_t plan = fitMemoryBudget(constraints, options.max_memory, options.chunk_samples,
+      options.members_memory_only ? std::optional<size_t>(0) : std::nullopt);
+    chunk_samples = plan.chunk_samples;
+    queue_depth = plan.queue_depth;
+
+    spdlog::info("Memory budget {} MiB{}: queue depth {}, expected peak {} MiB",
+      options.max_memory >> 20, options.members_memory_only ? " for members" : "", queue_depth, plan.peak_bytes >> 20);
+    if (plan.peak_bytes > options.max_memory)
+      spdlog::warn("Memory budget too small for this capture, using the smallest settings");
+  }
+  else if (options.chunk_samples > 0)
+  {
+    chunk_samples = alignChunkSamples(options.chunk_samples, granularity);
+  }
+  else
+  {
+    chunk_samples = chooseChunkSamples(constraints);
+  }
+
+  spdlog::info("Chunk size: {} samples{}", chunk_samples, options.chunk_samples > 0 ? "" : " (adaptive)");
+
+  // Members in archive order: sample members are only described here, the pipeline converts them
+  std::vector<std::string> names;
+  std::vector<member_source_t> members;
+
+  // Start parsing analog channels and create binary files in the ZIP archive
+  size_t data_offset = DATA_OFFSET;
+  for (size_t channel = 0, active_channel = 0; channel < header.analog_ch_on.size(); channel++)
+  {
+    if (!header.analog_ch_on[channel])
+      continue;
+
+    spdlog::info("Planning analog channel {}", channel);
+
+    SiglentAnalogReader reader(data_offset, header.analog_size);
+
+    reader.open(file);
+
+    // 8 bit samples: all 256 possible volt values are computed once per channel
+    const AnalogLut lut(header, channel);
+
+    // Start of the window: only its samples are mapped in and converted
+    const size_t begin = std::min(window.begin, analog_total);
+    const size_t end = std::min(window.end, analog_total);
+    reader.skip(begin / oversample_factor);
+
+    // Avoid the generation of a single large binary file. Split same channel data in multiple smaller files.
+    // Chunks are whole replicas: a window starting within replicas of a sample starts every member the same way.
+    for (size_t chunk_idx = 0, chunk_begin = begin; chunk_begin < end; chunk_idx++, chunk_begin += chunk_samples)
+    {
+      const size_t samples = std::min(chunk_samples, end - chunk_begin);
+      const size_t phase = chunk_begin % oversample_factor;
+
+      auto member = trimMember(
+        analogMember(reader, (phase + samples + oversample_factor - 1) / oversample_factor, lut, oversample_factor),
+        phase * sizeof(float), samples * sizeof(float));
+      member.compression = options.analog_compression;
+      reader.skip(chunk_samples / oversample_factor);
+
+      // srzip specification: analog probes file must have analog-1-x-y filename, where:
+      // x is a progressive probe number, starting from 1 and counting both digital and analog active probes.
+      // y is a progressive number, starting from 1, counting the chunks in which the raw probe data is splitted.
+      std::stringstream ss;
+      ss << "analog-1-" << (header.digital_on ? digital_labels.size() : 0) + active_channel + 1 << "-" << chunk_idx + 1;
+
+      names.push_back(ss.str());
+      members.push_back(std::move(member));
+    }
+
+    active_channel++;
+    data_offset += header.analog_size;
+  }
+
+  // Start parsing digital channels and create binary files in the ZIP archive
+  if (header.digital_on)
+  {
+    int digital_channel_no = digital_labels.size();
+
+    SiglentDigitalReader reader(data_offset, digital_channel_no, header.digital_size / 8);
+
+    reader.open(file);
+
+    // Whole octets are read, the samples of the window before and after them dropped
+    const size_t begin = std::min(window.begin, digital_total);
+    const size_t end = std::min(window.end, digital_total);
+    reader.skip(begin / 8 * 8);
+
+    for (size_t chunk_idx = 0, chunk_begin = begin; chunk_begin < end; chunk_idx++, chunk_begin += chunk_samples)
+    {
+      const size_t samples = std::min(chunk_samples, end - chunk_begin);
+      const size_t phase = chunk_begin % 8;
+
+      auto member = trimMember(logicMember(reader, (phase + samples + 7) / 8 * 8),
+        phase * sizeof(uint16_t), samples * sizeof(uint16_t));
+      member.compression = options.logic_compression;
+      reader.skip(chunk_samples);
+
+      // srzip specification: digital probes file must have logic-1-x filename, where:
+      // x is a progressive probe number, starting from 1, counting all active digital probes
+      std::stringstream ss;
+      ss << "logic-1-" << chunk_idx + 1;
+
+      names.push_back(ss.str());
+      members.push_back(std::move(member));
+    }
+  }
+
+  // Members of all channels are converted and deflated concurrently, and still written in order
+  ConversionPipeline pipeline(members, pool, queue_depth);
+
+  SrzipWriter writer(out_path);
+
+  // Compressed members are appended as they come out of the pipeline, in order
+  pipeline.start();
+
+  try {
+    for (size_t i = 0; i < members.size(); i++)
+      writer.add(names[i], *pipeline.take(i));
+
+    // srzip specification: zip file must contain a metadata file with probes description, samplerate, ...
+    writer.add("metadata", generateMetadata(header, analog_labels, digital_labels));
+
+    // srzip specification: zip file must contain a version file. Current version is 2.
+    writer.add("version", std::string("2"));
+
+    writer.close();
+  } catch (...) {
+    // A stage failure is the root cause of a writer failure
+    pipeline.finish();
+    throw;
+  }
+
+  pipeline.finish();
+  spdlog::info("Peak memory: {} MiB", peakResidentMemory() >> 20);
+}
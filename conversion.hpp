@@ -0,0 +1,45 @@
+#ifndef CONVERSION_HPP_
+#define CONVERSION_HPP_
+
+#include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <thread>
+
+#include "pipeline.hpp"
+#include "compression.hpp"
+#include "utils/thread_pool.hpp"
+
+struct conversion_options_t {
+  // Items each pipeline stage may run ahead of the next
+  size_t queue_depth = PIPELINE_QUEUE_DEPTH;
+
+  // Threads converting members concurrently
+  size_t jobs = std::thread::hardware_concurrency();
+
+  // Samples per member on the digital timebase, 0 to choose from the capture and the machine
+  size_t chunk_samples = 0;
+
+  // Bytes the conversion may use, 0 for no limit: chunk size and queue depth are reduced to fit
+  size_t max_memory = 0;
+
+  // max_memory is only for the members of this capture: the process and the pool are already
+  // accounted for by the caller, a batch sharing them between the captures it converts at once
+  bool members_memory_only = false;
+
+  // Time window converted, in seconds relative to the trigger: everything by default
+  double from = -std::numeric_limits<double>::infinity();
+  double to = std::numeric_limits<double>::infinity();
+
+  // Compression of analog-* and logic-* members
+  compression_t analog_compression = compression_t::DEFAULT;
+  compression_t logic_compression = compression_t::DEFAULT;
+};
+
+// Converts a Siglent binary capture into an srzip archive, on options.jobs threads
+void convertCapture(const std::filesystem::path& in_path, const std::filesystem::path& out_path, const conversion_options_t& options);
+
+// Same, converting members on pool: it may be shared with other conversions running at once
+void convertCapture(const std::filesystem::path& in_path, const std::filesystem::path& out_path, const conversion_options_t& options, ThreadPool& pool);
+
+#endif // CONVERSION_HPP_
@@ -0,0 +1,211 @@
+#include "crc32.hpp"
+
+#include <array>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define CRC32_HAVE_PCLMUL 1
+#endif
+
+static constexpr uint32_t POLY = 0xedb88320;
+
+// Slicing-by-8 tables: table[k][b] is the CRC of byte b followed by k zero bytes
+static constexpr auto make_tables()
+{
+  std::array<std::array<uint32_t, 256>, 8> t{};
+
+  for (uint32_t b = 0; b < 256; b++)
+  {
+    uint32_t c = b;
+    for (int i = 0; i < 8; i++)
+      c = c & 1 ? (c >> 1) ^ POLY : c >> 1;
+    t[0][b] = c;
+  }
+
+  for (size_t k = 1; k < 8; k++)
+    for (uint32_t b = 0; b < 256; b++)
+      t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xff];
+
+  return t;
+}
+
+static constexpr auto tables = make_tables();
+
+// Works on the inverted CRC register
+static uint32_t crc32_slice8(uint32_t c, const uint8_t* p, size_t len)
+{
+  for (; len >= 8; p += 8, len -= 8)
+  {
+    const uint32_t lo = c ^ (p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24);
+    const uint32_t hi = p[4] | p[5] << 8 | p[6] << 16 | (uint32_t)p[7] << 24;
+
+    c = tables[7][lo & 0xff] ^ tables[6][(lo >> 8) & 0xff] ^ tables[5][(lo >> 16) & 0xff] ^ tables[4][lo >> 24]
+      ^ tables[3][hi & 0xff] ^ tables[2][(hi >> 8) & 0xff] ^ tables[1][(hi >> 16) & 0xff] ^ tables[0][hi >> 24];
+  }
+
+  for (; len > 0; p++, len--)
+    c = (c >> 8) ^ tables[0][(c ^ *p) & 0xff];
+
+  return c;
+}
+
+uint32_t crc32_update_portable(uint32_t crc, std::span<const std::byte> data)
+{
+  return ~crc32_slice8(~crc, reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+#if defined(CRC32_HAVE_PCLMUL)
+
+// Folds x 128 bits forward over next
+__attribute__((target("pclmul,sse4.1")))
+static inline __m128i fold16(__m128i k, __m128i x, __m128i next)
+{
+  __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+  __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+  return _mm_xor_si128(_mm_xor_si128(hi, next), lo);
+}
+
+// Folds 64 bytes at a time with carry-less multiplications, then reduces to 32 bits (Barrett).
+// Constants are x^n mod P for the folding distances, bit-reflected, from Intel's
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+// len must be a multiple of 16, at least 64. Works on the inverted CRC register.
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t* buf, size_t len)
+{
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+
+  __m128i x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+  __m128i x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+  __m128i x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+  __m128i x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+  buf += 64;
+  len -= 64;
+
+  // Four independent folds in parallel
+  for (; len >= 64; buf += 64, len -= 64)
+  {
+    __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(buf + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(buf + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(buf + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(buf + 0x30)));
+  }
+
+  // Fold the four lanes into one
+  x1 = fold16(k3k4, x1, x2);
+  x1 = fold16(k3k4, x1, x3);
+  x1 = fold16(k3k4, x1, x4);
+
+  for (; len >= 16; buf += 16, len -= 16)
+    x1 = fold16(k3k4, x1, _mm_loadu_si128((const __m128i*)buf));
+
+  // 128 to 64 bits
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits
+  x2 = _mm_and_si128(x1, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+  x2 = _mm_and_si128(x2, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return _mm_extract_epi32(x1, 1);
+}
+
+uint32_t crc32_update(uint32_t crc, std::span<const std::byte> data)
+{
+  static const bool has_pclmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+  size_t len = data.size();
+  uint32_t c = ~crc;
+
+  if (has_pclmul && len >= 64)
+  {
+    const size_t folded = len & ~size_t(15);
+    c = crc32_pclmul(c, p, folded);
+    p += folded;
+    len -= folded;
+  }
+
+  return ~crc32_slice8(c, p, len);
+}
+
+#else
+
+uint32_t crc32_update(uint32_t crc, std::span<const std::byte> data)
+{
+  return crc32_update_portable(crc, data);
+}
+
+#endif
+
+// Polynomial arithmetic modulo P, bit-reflected (as in zlib's crc32_combine)
+static constexpr uint32_t multmodp(uint32_t a, uint32_t b)
+{
+  uint32_t m = 1u << 31;
+  uint32_t p = 0;
+
+  for (;;)
+  {
+    if (a & m)
+    {
+      p ^= b;
+      if ((a & (m - 1)) == 0)
+        break;
+    }
+    m >>= 1;
+    b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+  }
+
+  return p;
+}
+
+// x^(2^k) mod P
+static constexpr auto make_x2n()
+{
+  std::array<uint32_t, 32> t{};
+
+  uint32_t p = 1u << 30;  // x^1
+  t[0] = p;
+  for (size_t n = 1; n < 32; n++)
+    t[n] = p = multmodp(p, p);
+
+  return t;
+}
+
+static constexpr auto x2n_table = make_x2n();
+
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+  // crc1 shifted by len2 bytes (x^(8 len2)), then added to crc2
+  uint32_t p = 1u << 31;  // x^0
+  for (unsigned k = 3; len2; len2 >>= 1, k++)
+    if (len2 & 1)
+      p = multmodp(x2n_table[k & 31], p);
+
+  return multmodp(p, crc1) ^ crc2;
+}
@@ -0,0 +1,21 @@
+#ifndef CRC32_HPP_
+#define CRC32_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// CRC-32 as used by ZIP (reflected, polynomial 0xedb88320), same convention as zlib's crc32():
+// start from 0 and feed the previous result back to checksum data in pieces.
+// Uses carry-less multiplication folding (PCLMULQDQ) when the CPU has it, slicing tables otherwise.
+uint32_t crc32_update(uint32_t crc, std::span<const std::byte> data);
+
+// Portable implementation, also the reference for the accelerated one
+uint32_t crc32_update_portable(uint32_t crc, std::span<const std::byte> data);
+
+// CRC of the concatenation of two pieces, from their CRCs and the second piece length.
+// Not used by the conversion: a member is converted, checksummed and compressed by a single
+// pool task, so its CRC is never computed in pieces. Kept for callers that do split members.
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+#endif // CRC32_HPP_
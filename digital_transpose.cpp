@@ -0,0 +1,98 @@
+#include "digital_transpose.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void transpose_planes_scalar(std::span<const uint8_t* const> planes, size_t octets, std::span<uint16_t> out)
+{
+  assert(planes.size() <= 16);
+  assert(out.size() >= octets * 8);
+
+  std::fill(out.begin(), out.begin() + octets * 8, 0);
+
+  for (size_t channel = 0; channel < planes.size(); channel++)
+  {
+    for (size_t base = 0; base < octets; base++)
+    {
+      for (size_t bit = 0; bit < 8; bit++)
+        out[base * 8 + bit] |= ((((uint16_t)planes[channel][base] >> bit) & 0x01) << channel);
+    }
+  }
+}
+
+#if defined(__SSE2__)
+
+// Transposes a 16x16 byte matrix: on return row i, byte j holds what was row j, byte i.
+// Four rounds of interleaving row k with row k + 8 do the job (perfect shuffle).
+static inline void transpose_16x16(__m128i r[16])
+{
+  for (int round = 0; round < 4; round++)
+  {
+    __m128i t[16];
+    for (int k = 0; k < 8; k++)
+    {
+      t[2 * k] = _mm_unpacklo_epi8(r[k], r[k + 8]);
+      t[2 * k + 1] = _mm_unpackhi_epi8(r[k], r[k + 8]);
+    }
+    std::copy(t, t + 16, r);
+  }
+}
+
+void transpose_planes(std::span<const uint8_t* const> planes, size_t octets, std::span<uint16_t> out)
+{
+  assert(planes.size() <= 16);
+  assert(out.size() >= octets * 8);
+
+  const size_t channels = planes.size();
+  size_t base = 0;
+
+  // 16 octets of 16 channels per iteration: 128 output samples
+  for (; base + 16 <= octets; base += 16)
+  {
+    __m128i r[16];
+
+    // Row c is 16 octets of channel c, missing channels read as zero
+    for (size_t c = 0; c < 16; c++)
+      r[c] = c < channels ? _mm_loadu_si128((const __m128i*)(planes[c] + base)) : _mm_setzero_si128();
+
+    // Now row i holds octet base + i of every channel, byte c being channel c
+    transpose_16x16(r);
+
+    uint16_t* dst = out.data() + base * 8;
+    for (size_t i = 0; i < 16; i++)
+    {
+      // movemask gathers the top bit of every byte, i.e. bit 7 of all channels at once.
+      // Doubling each byte shifts the next bit into the top position.
+      __m128i v = r[i];
+      for (int bit = 7; bit >= 0; bit--)
+      {
+        dst[i * 8 + bit] = (uint16_t)_mm_movemask_epi8(v);
+        v = _mm_add_epi8(v, v);
+      }
+    }
+  }
+
+  // Less than 16 octets left
+  if (base < octets)
+  {
+    std::array<const uint8_t*, 16> tail;
+    for (size_t c = 0; c < channels; c++)
+      tail[c] = planes[c] + base;
+
+    transpose_planes_scalar(std::span(tail.data(), channels), octets - base, out.subspan(base * 8));
+  }
+}
+
+#else
+
+void transpose_planes(std::span<const uint8_t* const> planes, size_t octets, std::span<uint16_t> out)
+{
+  transpose_planes_scalar(planes, octets, out);
+}
+
+#endif
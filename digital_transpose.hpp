@@ -0,0 +1,19 @@
+#ifndef DIGITAL_TRANSPOSE_HPP_
+#define DIGITAL_TRANSPOSE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Siglent stores logic probes as one bit plane per channel: octet i of a plane holds samples 8i..8i+7,
+// least significant bit first. srzip wants one 16 bit word per sample, channel c on bit c.
+// These kernels merge up to 16 planes (planes[c] is channel c), each `octets` long,
+// into out, which must hold octets * 8 samples. out is overwritten, not or-ed into.
+
+// Reference implementation, one bit at a time
+void transpose_planes_scalar(std::span<const uint8_t* const> planes, size_t octets, std::span<uint16_t> out);
+
+// Vectorized implementation (SSE2 on x86), falls back to the scalar one elsewhere
+void transpose_planes(std::span<const uint8_t* const> planes, size_t octets, std::span<uint16_t> out);
+
+#endif // DIGITAL_TRANSPOSE_HPP_
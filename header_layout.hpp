@@ -0,0 +1,207 @@
+#ifndef HEADER_LAYOUT_HPP_
+#define HEADER_LAYOUT_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "siglent_bin.hpp"
+
+// How a header field is stored in the file
+enum class field_type_t {
+  // u4, 0 or 1
+  FLAG,
+  // u4
+  U32,
+  // f8 value, u4 magnitude, u4 unit
+  UNIT_VALUE
+};
+
+constexpr size_t wire_size(field_type_t type)
+{
+  return type == field_type_t::UNIT_VALUE ? 16 : 4;
+}
+
+// count consecutive values of the same type at offset, decoded into Member of header_t
+template<field_type_t Type, auto Member>
+struct header_field_t {
+  static constexpr field_type_t type = Type;
+  static constexpr auto member = Member;
+
+  const char* name;
+  size_t offset;
+  size_t count = 1;
+
+  constexpr size_t end() const { return offset + wire_size(Type) * count; }
+};
+
+// Header of the SDS1000X-E series, field names as in test/siglent-bin.ksy.
+// Other firmware layouts are new tables decoded by the same templates.
+inline constexpr auto SDS1000XE_LAYOUT = std::make_tuple(
+  header_field_t<field_type_t::FLAG, &header_t::analog_ch_on>{ "chx_on", 0x00, MAX_ANALOG_CHANNELS },
+  header_field_t<field_type_t::UNIT_VALUE, &header_t::analog_scales>{ "analog_scales", 0x10, MAX_ANALOG_CHANNELS },
+  header_field_t<field_type_t::UNIT_VALUE, &header_t::analog_offsets>{ "analog_offsets", 0x50, MAX_ANALOG_CHANNELS },
+  header_field_t<field_type_t::FLAG, &header_t::digital_on>{ "digital_on", 0x90 },
+  // Any non zero value is on: SDS00001.bin has 3 for probes of a disabled logic analyzer
+  header_field_t<field_type_t::U32, &header_t::digital_ch_on>{ "digital_ch_on", 0x94, MAX_DIGITAL_PROBES },
+  header_field_t<field_type_t::UNIT_VALUE, &header_t::time_div>{ "time_div", 0xd4 },
+  header_field_t<field_type_t::UNIT_VALUE, &header_t::time_delay>{ "time_delay", 0xe4 },
+  header_field_t<field_type_t::U32, &header_t::analog_size>{ "analog_size", 0xf4 },
+  header_field_t<field_type_t::UNIT_VALUE, &header_t::analog_sample_rate>{ "analog_sample_rate", 0xf8 },
+  header_field_t<field_type_t::U32, &header_t::digital_size>{ "digital_size", 0x108 },
+  header_field_t<field_type_t::UNIT_VALUE, &header_t::digital_sample_rate>{ "digital_sample_rate", 0x10c }
+);
+
+// The .ksy describes the header as a plain sequence: each field must start where the previous one ends
+template<typename Layout>
+constexpr bool is_sequential(const Layout& layout)
+{
+  return std::apply([] (const auto&... field) {
+    size_t next = 0;
+    return ((field.offset == std::exchange(next, field.end())) && ...);
+  }, layout);
+}
+
+template<typename Layout>
+constexpr size_t layout_end(const Layout& layout)
+{
+  return std::apply([] (const auto&... field) { return std::max({ field.end()... }); }, layout);
+}
+
+static_assert(std::tuple_size_v<std::remove_const_t<decltype(SDS1000XE_LAYOUT)>> == 11, "siglent-bin.ksy has 11 header fields");
+static_assert(is_sequential(SDS1000XE_LAYOUT), "Header fields out of the siglent-bin.ksy sequence");
+static_assert(layout_end(SDS1000XE_LAYOUT) == HEADER_SIZE, "HEADER_SIZE does not match the layout");
+
+// unit_value_t is copied as is from the file
+static_assert(sizeof(header_t::unit_value_t) == wire_size(field_type_t::UNIT_VALUE));
+static_assert(offsetof(header_t::unit_value_t, magnitude) == 8 && offsetof(header_t::unit_value_t, unit) == 12);
+static_assert(std::is_trivially_copyable_v<header_t::unit_value_t>);
+
+namespace header_layout {
+
+template<typename T>
+T load(std::span<const uint8_t> bytes, size_t offset)
+{
+  T ret;
+  std::memcpy(&ret, bytes.data() + offset, sizeof(T));
+  return ret;
+}
+
+template<typename Field>
+auto load_value(const Field& field, std::span<const uint8_t> bytes, size_t i)
+{
+  const size_t offset = field.offset + i * wire_size(Field::type);
+
+  if constexpr (Field::type == field_type_t::UNIT_VALUE)
+    return load<header_t::unit_value_t>(bytes, offset);
+  else
+    return load<uint32_t>(bytes, offset);
+}
+
+// Calls f(field, i) on every value of every field, in layout order
+template<typename Layout, typename F>
+void for_each_value(const Layout& layout, F&& f)
+{
+  std::apply([&f] (const auto&... field) {
+    (..., [&] {
+      for (size_t i = 0; i < field.count; i++)
+        f(field, i);
+    }());
+  }, layout);
+}
+
+}
+
+// Decodes bytes, at least layout_end(Layout) long: unrolled into fixed offset loads
+template<const auto& Layout>
+header_t decode_header(std::span<const uint8_t> bytes)
+{
+  header_t h = {};
+
+  header_layout::for_each_value(Layout, [&] (const auto& field, size_t i) {
+    using field_type = std::remove_cvref_t<decltype(field)>;
+    auto& dst = h.*field_type::member;
+    const auto value = header_layout::load_value(field, bytes, i);
+
+    if constexpr (requires { dst[i]; })
+      dst[i] = value;
+    else
+      dst = value;
+  });
+
+  return h;
+}
+
+// Describes every value that cannot come from an oscilloscope, one message each.
+// Units are not checked: real captures carry arbitrary bytes there (see test/SDS00001.bin).
+template<const auto& Layout>
+std::vector<std::string> validate_fields(std::span<const uint8_t> bytes)
+{
+  std::vector<std::string> problems;
+
+  header_layout::for_each_value(Layout, [&] (const auto& field, size_t i) {
+    using field_type = std::remove_cvref_t<decltype(field)>;
+    const auto value = header_layout::load_value(field, bytes, i);
+
+    std::stringstream name;
+    name << field.name;
+    if (field.count > 1)
+      name << "[" << i << "]";
+
+    if constexpr (field_type::type == field_type_t::FLAG)
+    {
+      if (value > 1)
+        problems.push_back(name.str() + ": " + std::to_string(value) + " is not 0 or 1");
+    }
+    else if constexpr (field_type::type == field_type_t::UNIT_VALUE)
+    {
+      if (!std::isfinite(value.value))
+        problems.push_back(name.str() + ": value is not a number");
+      if (value.magnitude > magnitude_t::PETA)
+        problems.push_back(name.str() + ": unknown magnitude " + std::to_string(uint32_t(value.magnitude)));
+    }
+  });
+
+  return problems;
+}
+
+// One line per value: offset, name and raw content
+template<const auto& Layout>
+std::string dump_fields(std::span<const uint8_t> bytes)
+{
+  std::stringstream out;
+
+  header_layout::for_each_value(Layout, [&] (const auto& field, size_t i) {
+    using field_type = std::remove_cvref_t<decltype(field)>;
+    const auto value = header_layout::load_value(field, bytes, i);
+
+    char offset[8];
+    std::snprintf(offset, sizeof(offset), "0x%03zx", field.offset + i * wire_size(field_type::type));
+
+    out << offset << " " << field.name;
+    if (field.count > 1)
+      out << "[" << i << "]";
+    out << " = ";
+
+    if constexpr (field_type::type == field_type_t::UNIT_VALUE)
+      out << value.value << " (magnitude " << uint32_t(value.magnitude) << ", unit " << uint32_t(value.unit) << ")";
+    else
+      out << value;
+
+    out << "\n";
+  });
+
+  return out.str();
+}
+
+#endif // HEADER_LAYOUT_HPP_
@@ -0,0 +1,209 @@
+#include "info.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <future>
+#include <sstream>
+
+#include "siglent_data.hpp"
+#include "utils/thread_pool.hpp"
+
+capture_info_t readCaptureInfo(const std::filesystem::path& path)
+{
+  capture_info_t info;
+  info.path = path;
+
+  try {
+    std::array<uint8_t, HEADER_SIZE> buffer;
+    const auto bytes = std::span(buffer).first(read_siglent_header(path, buffer));
+
+    info.header = parse(bytes);
+    info.problems = validate_header(bytes);
+
+    std::error_code ec;
+    info.size = std::filesystem::file_size(path, ec);
+  } catch (const std::exception& e) {
+    info.error = e.what();
+  }
+
+  return info;
+}
+
+std::vector<capture_info_t> scanCaptures(const std::vector<std::filesystem::path>& inputs, size_t jobs)
+{
+  std::vector<capture_info_t> infos(inputs.size());
+
+  // Each header is a single small read: many of them in flight hide the storage latency
+  ThreadPool pool(std::min(jobs, std::max<size_t>(inputs.size(), 1)));
+
+  std::vector<std::future<void>> done;
+  done.reserve(inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++)
+    done.push_back(pool.submit([&infos, &inputs, i] { infos[i] = readCaptureInfo(inputs[i]); }));
+
+  for (auto& d : done)
+    d.get();
+
+  return infos;
+}
+
+double captureDuration(const header_t& header)
+{
+  const double rate = header.digital_on ? header.digital_sample_rate.value : header.analog_sample_rate.value;
+  const double samples = header.digital_on ? header.digital_size : header.analog_size;
+
+  return rate > 0 ? samples / rate : 0;
+}
+
+// 3 significant digits and an SI prefix: 1.25 GSa/s, 14 ms
+static std::string si(double value, const char* unit)
+{
+  static const char* const prefixes[] = { "p", "n", "u", "m", "", "k", "M", "G", "T" };
+  const int base = 4;
+
+  int exponent = 0;
+  if (value != 0 && std::isfinite(value))
+    exponent = std::clamp(int(std::floor(std::log10(std::abs(value)) / 3)), -base, base);
+
+  char out[32];
+  std::snprintf(out, sizeof(out), "%.3g %s%s", value / std::pow(1000.0, exponent), prefixes[base + exponent], unit);
+
+  std::string ret = out;
+  ret.erase(ret.find_last_not_of(' ') + 1);
+  return ret;
+}
+
+static std::string join(const std::vector<std::string>& items, const char* separator)
+{
+  std::string out;
+  for (const auto& item : items)
+    out += (out.empty() ? "" : separator) + item;
+  return out;
+}
+
+std::string formatInfoTable(const std::vector<capture_info_t>& infos)
+{
+  std::vector<std::vector<std::string>> rows;
+  rows.push_back({ "FILE", "SIZE", "ANALOG", "RATE", "SAMPLES", "DIGITAL", "RATE", "SAMPLES", "DURATION", "NOTES" });
+
+  for (const auto& info : infos)
+  {
+    if (!info.error.empty())
+    {
+      rows.push_back({ info.path.string(), "", "", "", "", "", "", "", "", "error: " + info.error });
+      continue;
+    }
+
+    const header_t& h = info.header;
+    const auto analog = getAnalogLabes(h);
+    const auto digital = getDigitalLabes(h);
+
+    char size[32];
+    std::snprintf(size, sizeof(size), "%.1f MiB", info.size / 1048576.0);
+
+    rows.push_back({
+      info.path.string(),
+      size,
+      analog.empty() ? "-" : join(analog, ","),
+      analog.empty() ? "-" : si(h.analog_sample_rate.value, "Sa/s"),
+      analog.empty() ? "-" : si(h.analog_size, ""),
+      digital.empty() ? "-" : join(digital, ","),
+      digital.empty() ? "-" : si(h.digital_sample_rate.value, "Sa/s"),
+      digital.empty() ? "-" : si(h.digital_size, ""),
+      si(captureDuration(h), "s"),
+      join(info.problems, "; ") });
+  }
+
+  std::vector<size_t> widths(rows.front().size());
+  for (const auto& row : rows)
+    for (size_t c = 0; c < row.size(); c++)
+      widths[c] = std::max(widths[c], row[c].size());
+
+  std::stringstream out;
+  for (const auto& row : rows)
+  {
+    std::string line;
+    for (size_t c = 0; c < row.size(); c++)
+      line += row[c] + std::string(c + 1 < row.size() ? widths[c] - row[c].size() + 2 : 0, ' ');
+
+    // Empty trailing cells leave no trailing spaces
+    line.erase(line.find_last_not_of(' ') + 1);
+    out << line << "\n";
+  }
+
+  return out.str();
+}
+
+static std::string json_string(const std::string& s)
+{
+  std::string out = "\"";
+  for (unsigned char c : s)
+  {
+    if (c == '"' || c == '\\')
+    {
+      out += '\\';
+      out += c;
+    }
+    else if (c < 0x20)
+    {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    }
+    else
+    {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+// Shortest representation reading back to the same double, null when JSON has none
+static std::string json_number(double value)
+{
+  if (!std::isfinite(value))
+    return "null";
+
+  char out[32];
+  auto end = std::to_chars(out, out + sizeof(out), value).ptr;
+  return std::string(out, end);
+}
+
+static std::string json_array(const std::vector<std::string>& items, bool quoted)
+{
+  std::vector<std::string> values;
+  for (const auto& item : items)
+    values.push_back(quoted ? json_string(item) : item);
+  return "[" + join(values, ",") + "]";
+}
+
+std::string formatInfoJson(const capture_info_t& info)
+{
+  std::stringstream out;
+  out << "{\"path\":" << json_string(info.path.string());
+
+  if (!info.error.empty())
+  {
+    out << ",\"error\":" << json_string(info.error) << "}";
+    return out.str();
+  }
+
+  const header_t& h = info.header;
+
+  out << ",\"size\":" << info.size
+    << ",\"analog_channels\":" << json_array(getAnalogLabes(h), false)
+    << ",\"analog_sample_rate\":" << json_number(h.analog_sample_rate.value)
+    << ",\"analog_size\":" << h.analog_size
+    << ",\"digital_channels\":" << json_array(getDigitalLabes(h), false)
+    << ",\"digital_sample_rate\":" << json_number(h.digital_sample_rate.value)
+    << ",\"digital_size\":" << h.digital_size
+    << ",\"time_div\":" << json_number(h.time_div.value)
+    << ",\"time_delay\":" << json_number(h.time_delay.value)
+    << ",\"duration\":" << json_number(captureDuration(h))
+    << ",\"problems\":" << json_array(info.problems, true)
+    << "}";
+
+  return out.str();
+}
@@ -0,0 +1,45 @@
+#ifndef INFO_HPP_
+#define INFO_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "siglent_bin.hpp"
+
+// Headers read at once by default: each is a single small read, mostly waiting on storage
+const size_t INFO_JOBS = 32;
+
+// What the header of a capture tells, read without touching its samples
+struct capture_info_t {
+  std::filesystem::path path;
+
+  uint64_t size = 0;
+
+  header_t header = {};
+
+  // Header values no oscilloscope writes, see validate_header
+  std::vector<std::string> problems;
+
+  // Why the header could not be read, empty on success
+  std::string error;
+};
+
+// Reads the header of one capture. Failures are recorded in error, not thrown.
+capture_info_t readCaptureInfo(const std::filesystem::path& path);
+
+// Headers of every capture, read on jobs threads, in input order
+std::vector<capture_info_t> scanCaptures(const std::vector<std::filesystem::path>& inputs, size_t jobs);
+
+// Seconds of signal held by the capture, on the digital timebase when logic probes are on
+double captureDuration(const header_t& header);
+
+// Aligned table, one capture per line after a title line
+std::string formatInfoTable(const std::vector<capture_info_t>& infos);
+
+// One JSON object on a single line, without the line feed
+std::string formatInfoJson(const capture_info_t& info);
+
+#endif // INFO_HPP_
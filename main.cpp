@@ -1,3 +1,4 @@
+#include <atomic>
 #include <iostream>
 #include <vector>
 #include <cstring>
@@ -6,216 +7,306 @@
 #include <filesystem>
 #include <algorithm>
 #include <cmath>
+#include <thread>
+#include <csignal>
+#include <optional>
+#include <sstream>
 
-#include <zip.h>
 #include <argparse/argparse.hpp>
 #include <spdlog/spdlog.h>
 
-#include "siglent_bin.hpp"
-#include "siglent_data.hpp"
-#include "srzip.hpp"
+#include "conversion.hpp"
+#include "batch.hpp"
+#include "chunking.hpp"
+#include "watch.hpp"
+#include "info.hpp"
+#include "capture_index.hpp"
 
-zip_t* zip_flush(zip_t* zip, std::string filename)
+// Watch mode ends on SIGINT or SIGTERM, once the captures already seen are converted
+static std::atomic<const FolderWatcher*> active_watcher = nullptr;
+static_assert(std::atomic<const FolderWatcher*>::is_always_lock_free, "Signal handlers may only use lock-free atomics");
+
+static void stop_watching(int)
 {
-  zip_close(zip);
-  return zip_open(filename.c_str(), 0, NULL);
+  if (const FolderWatcher* watcher = active_watcher.load())
+    watcher->stop();
 }
 
-int main(int argc, const char** argv) {
+// siglent-bin2sr info: headers only, nothing is converted
+static int runInfo(int argc, const char** argv) {
 
-  // Initialize argument parsing
-  argparse::ArgumentParser program("siglent-bin2sr");
+  argparse::ArgumentParser program("siglent-bin2sr info");
 
-  program.add_argument("input").help("Input filename");
-  program.add_argument("-o", "--output").help("Output folder");
-  program.add_argument("-v", "--verbose").help("Increase verbosity")
+  program.add_argument("input").help("Input files, folders of .bin files or glob patterns")
+    .nargs(argparse::nargs_pattern::at_least_one);
+  program.add_argument("--json").help("One JSON object per capture and line instead of a table")
     .default_value(false)
     .implicit_value(true);
+  program.add_argument("-j", "--jobs").help("Number of headers read at once")
+    .default_value(INFO_JOBS)
+    .scan<'u', size_t>();
 
+  std::vector<std::filesystem::path> inputs;
   try {
     program.parse_args(argc, argv);
-  } catch (const std::runtime_error& e) {
+    inputs = expandInputs(program.get<std::vector<std::string>>("input"));
+  } catch (const std::exception& e) {
     spdlog::error(e.what());
-    std::exit(1);
-  }
-
-  // Prepare input and output file
-  // Default output folder is same as input
-  std::filesystem::path in_path = program.get("input");
-  std::filesystem::path out_path = in_path.parent_path();
-
-  if (!std::filesystem::exists(in_path)) {
-    spdlog::error("Input file {} does not exist", in_path.c_str());
-    std::exit(1);
+    return 1;
   }
 
-  if (auto fn = program.present("-o")) {
-    out_path = *fn;
-    if (!std::filesystem::exists(out_path) ||
-        !std::filesystem::is_directory(out_path)) {
-      spdlog::error("Output folder {} does not exist or is invalid", out_path.c_str());
-      std::exit(1);
-    }
-  }
-  out_path /= in_path.stem();
-  out_path += ".srzip";
+  const auto infos = scanCaptures(inputs, program.get<size_t>("--jobs"));
 
-  if (program["--verbose"] == true) {
-    spdlog::set_level(spdlog::level::trace);
+  if (program["--json"] == true) {
+    for (const auto& info : infos)
+      std::cout << formatInfoJson(info) << "\n";
+  } else {
+    std::cout << formatInfoTable(infos);
   }
 
-  // Parse header, else error
-  header_t header = parse_siglent_header_file(in_path);
-
-  // Debugging informations
-  spdlog::info("Parsed header");
-  spdlog::trace("Active analog channels: {}", std::count(header.analog_ch_on.begin(), header.analog_ch_on.end(), true) );
-  spdlog::trace("Analog sample rate: {}", header.analog_sample_rate.get_value());
-  spdlog::trace("Analog size: {}", header.analog_size);
-  if (header.digital_on) {
-    spdlog::trace("Active digital channels: {}", std::count(header.digital_ch_on.begin(), header.digital_ch_on.end(), true));
-    spdlog::trace("Digital sample rate: {}", header.digital_sample_rate.get_value());
-    spdlog::trace("Digital size: {}", header.digital_size);
-  }
+  const bool failed = std::any_of(infos.begin(), infos.end(), [] (const capture_info_t& info) { return !info.error.empty(); });
+  return failed ? 1 : 0;
+}
 
-  zip_t* zip = zip_open(out_path.c_str(), ZIP_CREATE | ZIP_TRUNCATE, NULL);
+// siglent-bin2sr index: adds captures to the index, refreshing what changed
+static int runIndex(int argc, const char** argv) {
 
-  // Fetch channels labels from header, counting the active ones
-  const std::vector<std::string> analog_labels =
-    getAnalogLabes(header);
-  const std::vector<std::string> digital_labels =
-    getDigitalLabes(header);
+  argparse::ArgumentParser program("siglent-bin2sr index");
 
-  // Start parsing analog channels and create binary files in the ZIP archive
-  size_t data_offset = DATA_OFFSET;
-  for (size_t channel = 0, active_channel = 0; channel < header.analog_ch_on.size(); channel++)
-  {
-    if (!header.analog_ch_on[channel])
-      continue;
+  program.add_argument("input").help("Input files, folders of .bin files or glob patterns; none to refresh the index")
+    .nargs(argparse::nargs_pattern::any);
+  program.add_argument("--index").help("Index file")
+    .default_value(std::string(INDEX_DEFAULT_FILE));
+  program.add_argument("-j", "--jobs").help("Number of headers read at once")
+    .default_value(INFO_JOBS)
+    .scan<'u', size_t>();
 
-    spdlog::info("Reading analog channel {}", channel);
+  try {
+    program.parse_args(argc, argv);
 
-    SiglentAnalogReader reader(data_offset, header.analog_size);
+    const auto input_args = program.get<std::vector<std::string>>("input");
+    const auto inputs = input_args.empty() ? std::vector<std::filesystem::path>() : expandInputs(input_args);
 
-    reader.open(in_path);
+    CaptureIndex index(program.get("--index"));
+    const index_update_t stats = index.update(inputs, program.get<size_t>("--jobs"));
 
-    // Assumption: on siglent oscilloscope, digital probes have higher sample rate than analog ones.
-    // If digital enabled, analog may require oversampling. Add some replicas to have equal amount of samples
-    // between analog and digital channels.
-    size_t oversample_factor = 1;
-    if (header.digital_on)
-      oversample_factor = header.digital_size / header.analog_size;
+    spdlog::info("{}: {} captures, {} read, {} unchanged, {} removed",
+      program.get("--index"), index.size(), stats.scanned, stats.unchanged, stats.removed);
+  } catch (const std::exception& e) {
+    spdlog::error(e.what());
+    return 1;
+  }
 
-    // Avoid the generation of a single large binary file. Split same channel data in multiple smaller files.
-    for (size_t chunk_idx = 0; ; chunk_idx++)
-    {
-      spdlog::trace("Reading chunk {}", chunk_idx);
+  return 0;
+}
 
-      auto chunk = reader.chunk(SAMPLES_LIMIT / oversample_factor);
+// siglent-bin2sr query: captures of the index matching every criterion given
+static int runQuery(int argc, const char** argv) {
 
-      if (chunk.size() == 0)
-        break;
+  argparse::ArgumentParser program("siglent-bin2sr query");
 
-      std::vector<float> out_chunk;
-      out_chunk.reserve(SAMPLES_LIMIT);
+  program.add_argument("--index").help("Index file")
+    .default_value(std::string(INDEX_DEFAULT_FILE));
+  program.add_argument("--min-rate").help("Lowest sample rate in Sa/s, such as 1e9")
+    .scan<'g', double>();
+  program.add_argument("--max-rate").help("Highest sample rate in Sa/s")
+    .scan<'g', double>();
+  program.add_argument("--analog").help("Analog channels that must be on, such as 1,3");
+  program.add_argument("--digital").help("Logic probes must be on")
+    .default_value(false)
+    .implicit_value(true);
+  program.add_argument("--json").help("One JSON object per capture and line instead of a table")
+    .default_value(false)
+    .implicit_value(true);
 
-      std::transform(chunk.cbegin(), chunk.cend(), std::back_inserter(out_chunk), [&] (uint8_t sample)
-      {
-        // TODO documentation
-        double ret = double(int(sample)-128) * header.analog_scales[channel].get_value() * 10.7 / 256;
-        ret -= header.analog_offsets[channel].get_value();
-        for (size_t i = 1; i < oversample_factor; i++)
-          out_chunk.push_back((float)ret);
-        return (float)ret;
-      });
+  try {
+    program.parse_args(argc, argv);
 
-      zip_source_t* source = zip_source_buffer(zip, out_chunk.data(), sizeof(out_chunk[0]) * out_chunk.size(), 0);
+    index_query_t query;
+    if (auto rate = program.present<double>("--min-rate"))
+      query.min_sample_rate = *rate;
+    if (auto rate = program.present<double>("--max-rate"))
+      query.max_sample_rate = *rate;
+    if (auto channels = program.present("--analog")) {
+      std::stringstream ss(*channels);
+      for (std::string channel; std::getline(ss, channel, ','); ) {
+        const int c = std::stoi(channel);
+        if (c < 1 || c > MAX_ANALOG_CHANNELS)
+          throw std::runtime_error("No analog channel " + channel);
+        query.analog_channels |= 1u << (c - 1);
+      }
+    }
+    query.digital = program["--digital"] == true;
 
-      if (source == NULL)
-        std::cout << "error creating source: " << zip_strerror(zip) << std::endl;
+    const std::string filename = program.get("--index");
+    if (!std::filesystem::exists(filename))
+      throw std::runtime_error("No index " + filename + ", create it with siglent-bin2sr index");
 
-      // srzip specification: analog probes file must have analog-1-x-y filename, where:
-      // x is a progressive probe number, starting from 1 and counting both digital and analog active probes.
-      // y is a progressive number, starting from 1, counting the chunks in which the raw probe data is splitted.
-      std::stringstream ss;
-      ss << "analog-1-" << (header.digital_on ? digital_labels.size() : 0) + active_channel + 1 << "-" << chunk_idx + 1;
+    const CaptureIndex index(filename);
 
-      if (zip_file_add(zip, ss.str().c_str(), source, ZIP_FL_ENC_UTF_8) < 0)
-        std::cout << "error adding file: " << zip_strerror(zip) << std::endl;
+    std::vector<capture_info_t> matches;
+    for (const index_record_t* record : index.query(query))
+      matches.push_back(index.info(*record));
 
-      // Commit
-      zip = zip_flush(zip, out_path.c_str());
+    if (program["--json"] == true) {
+      for (const auto& info : matches)
+        std::cout << formatInfoJson(info) << "\n";
+    } else {
+      std::cout << formatInfoTable(matches);
     }
-
-    active_channel++;
-    data_offset += header.analog_size;
+  } catch (const std::exception& e) {
+    spdlog::error(e.what());
+    return 1;
   }
 
-  // Start parsing digital channels and create binary files in the ZIP archive
-  if (header.digital_on)
-  {
-    int digital_channel_no = digital_labels.size();
+  return 0;
+}
 
-    SiglentDigitalReader reader(data_offset, digital_channel_no, header.digital_size / 8);
+int main(int argc, const char** argv) {
 
-    reader.open(in_path);
+  // Subcommands taken before the converter arguments: a capture named info is still ./info
+  if (argc > 1 && std::strcmp(argv[1], "info") == 0)
+    return runInfo(argc - 1, argv + 1);
+  if (argc > 1 && std::strcmp(argv[1], "index") == 0)
+    return runIndex(argc - 1, argv + 1);
+  if (argc > 1 && std::strcmp(argv[1], "query") == 0)
+    return runQuery(argc - 1, argv + 1);
 
-    for (size_t chunk_idx = 0; ; chunk_idx++)
-    {
-      spdlog::trace("Reading chunk {}", chunk_idx);
+  // Initialize argument parsing
+  argparse::ArgumentParser program("siglent-bin2sr");
 
-      auto chunk = reader.chunk(SAMPLES_LIMIT);
+  program.add_argument("input").help("Input files, folders of .bin files or glob patterns")
+    .nargs(argparse::nargs_pattern::any);
+  program.add_argument("-o", "--output").help("Output folder");
+  program.add_argument("--watch").help("Convert captures as they are saved into this folder, until interrupted");
+  program.add_argument("--queue-depth").help("Blocks each pipeline stage may run ahead of the next")
+    .default_value(PIPELINE_QUEUE_DEPTH)
+    .scan<'u', size_t>();
+  program.add_argument("-j", "--jobs").help("Number of conversion threads")
+    .default_value(size_t(std::max(1u, std::thread::hardware_concurrency())))
+    .scan<'u', size_t>();
+  program.add_argument("--chunk-samples").help("Samples per archive member, chosen from the capture and the machine by default")
+    .scan<'u', size_t>();
+  program.add_argument("--max-memory").help("Memory the conversion may use, such as 512M or 2G");
+  program.add_argument("--parallel-files").help("Number of captures converted at once, sharing the conversion threads")
+    .default_value(BATCH_PARALLEL_FILES)
+    .scan<'u', size_t>();
+  program.add_argument("--compression").help("Compression of sample members: store, fast, default or best")
+    .default_value(std::string("default"));
+  program.add_argument("--analog-compression").help("Compression of analog members, overrides --compression");
+  program.add_argument("--logic-compression").help("Compression of logic members, overrides --compression");
+  program.add_argument("--from").help("Convert from this time, in seconds relative to the trigger (may be negative)")
+    .scan<'g', double>();
+  program.add_argument("--to").help("Convert up to this time, in seconds relative to the trigger")
+    .scan<'g', double>();
+  program.add_argument("-v", "--verbose").help("Increase verbosity")
+    .default_value(false)
+    .implicit_value(true);
 
-      if (chunk.size() == 0)
-        break;
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error& e) {
+    spdlog::error(e.what());
+    std::exit(1);
+  }
 
-      zip_source_t* source = zip_source_buffer(zip, chunk.data(), sizeof(chunk[0]) * chunk.size(), 0);
+  // Prepare input files and output folder
+  const auto input_args = program.get<std::vector<std::string>>("input");
+  const auto watch_dir = program.present("--watch");
 
-      if (source == NULL)
-        std::cout << "error creating source: " << zip_strerror(zip) << std::endl;
+  if (input_args.empty() && !watch_dir) {
+    spdlog::error("No input file given");
+    std::exit(1);
+  }
 
-      // srzip specification: digital probes file must have logic-1-x filename, where:
-      // x is a progressive probe number, starting from 1, counting all active digital probes
-      std::stringstream ss;
-      ss << "logic-1-" << chunk_idx + 1;
+  std::vector<std::filesystem::path> inputs;
+  try {
+    if (!input_args.empty())
+      inputs = expandInputs(input_args);
+  } catch (const std::exception& e) {
+    spdlog::error(e.what());
+    std::exit(1);
+  }
 
-      if (zip_file_add(zip, ss.str().c_str(), source, ZIP_FL_ENC_UTF_8) < 0)
-        std::cout << "error adding file: " << zip_strerror(zip) << std::endl;
+  batch_options_t batch;
 
-      zip = zip_flush(zip, out_path.c_str());
+  if (auto fn = program.present("-o")) {
+    batch.output_dir = *fn;
+    if (!std::filesystem::exists(batch.output_dir) ||
+        !std::filesystem::is_directory(batch.output_dir)) {
+      spdlog::error("Output folder {} does not exist or is invalid", batch.output_dir.c_str());
+      std::exit(1);
     }
   }
 
-  // srzip specification: zip file must contain a metadata file with probes description, samplerate, ...
-  {
-    std::string str = generateMetadata(header, analog_labels, digital_labels);
+  if (program["--verbose"] == true) {
+    spdlog::set_level(spdlog::level::trace);
+  }
 
-    zip_source_t* source = zip_source_buffer(zip, str.c_str(), str.length(), 0);
+  conversion_options_t& options = batch.conversion;
+  options.queue_depth = program.get<size_t>("--queue-depth");
+  options.jobs = program.get<size_t>("--jobs");
+  if (auto n = program.present<size_t>("--chunk-samples"))
+    options.chunk_samples = *n;
+  if (auto t = program.present<double>("--from"))
+    options.from = *t;
+  if (auto t = program.present<double>("--to"))
+    options.to = *t;
 
-    if (source == NULL)
-      std::cout << "error creating source: " << zip_strerror(zip) << "\n";
+  try {
+    options.analog_compression = options.logic_compression = parse_compression(program.get("--compression"));
+    if (auto c = program.present("--analog-compression"))
+      options.analog_compression = parse_compression(*c);
+    if (auto c = program.present("--logic-compression"))
+      options.logic_compression = parse_compression(*c);
+    if (auto m = program.present("--max-memory"))
+      options.max_memory = parse_memory_size(*m);
+  } catch (const std::runtime_error& e) {
+    spdlog::error(e.what());
+    std::exit(1);
+  }
+
+  batch.parallel_files = program.get<size_t>("--parallel-files");
+
+  size_t failed = 0;
 
-    if (zip_file_add(zip, "metadata", source, ZIP_FL_OVERWRITE) < 0)
-      std::cout << "error adding file: " << zip_strerror(zip) << "\n";
+  if (!inputs.empty()) {
+    const batch_summary_t summary = convertBatch(inputs, batch);
+    failed += summary.failed;
 
-    zip = zip_flush(zip, out_path.c_str());
+    if (inputs.size() > 1)
+      spdlog::info("Converted {} of {} captures in {:.1f} s: {:.1f} MiB read, {:.1f} MiB written, {:.1f} MiB/s",
+        summary.converted, inputs.size(), summary.seconds, summary.input_bytes / 1048576.0, summary.output_bytes / 1048576.0,
+        summary.seconds > 0 ? summary.input_bytes / 1048576.0 / summary.seconds : 0.0);
   }
 
-  // srzip specification: zip file must contain a version file. Current version is 2.
-  {
-    std::string version = "2";
+  if (watch_dir) {
+    // Outlives the signal handlers pointing to it
+    std::optional<FolderWatcher> watcher;
 
-    zip_source_t* source = zip_source_buffer(zip, version.c_str(), version.length(), 0);
+    try {
+      watcher.emplace(*watch_dir);
 
-    if (source == NULL)
-      std::cout << "error creating source: " << zip_strerror(zip) << "\n";
+      active_watcher = &*watcher;
+      std::signal(SIGINT, stop_watching);
+      std::signal(SIGTERM, stop_watching);
 
-    if (zip_file_add(zip, "version", source, ZIP_FL_OVERWRITE) < 0)
-      std::cout << "error adding file: " << zip_strerror(zip) << "\n";
+      const batch_summary_t summary = watchFolder(*watcher, batch);
+      failed += summary.failed;
 
-    zip = zip_flush(zip, out_path.c_str());
+      spdlog::info("Stopped watching {}: {} captures converted, {} failed", *watch_dir, summary.converted, summary.failed);
+    } catch (const std::exception& e) {
+      spdlog::error(e.what());
+      failed++;
+    }
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    active_watcher = nullptr;
   }
 
-  // Close sr zipfile
-  zip_close(zip);
+  if (failed > 0) {
+    spdlog::error("{} capture(s) failed", failed);
+    std::exit(1);
+  }
 }
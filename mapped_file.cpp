@@ -0,0 +1,144 @@
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& filename)
+{
+  open(filename);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+: addr(std::exchange(other.addr, nullptr)),
+length(std::exchange(other.length, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other)
+  {
+    close();
+    addr = std::exchange(other.addr, nullptr);
+    length = std::exchange(other.length, 0);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+void MappedFile::open(const std::string& filename)
+{
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Failed opening " + filename);
+
+  struct stat st;
+  if (fstat(fd, &st) < 0)
+  {
+    ::close(fd);
+    throw std::runtime_error("Failed reading size of " + filename);
+  }
+
+  // mmap refuses zero-length mappings: an empty file is an open file with no data
+  if (st.st_size == 0)
+  {
+    ::close(fd);
+    static const uint8_t empty = 0;
+    addr = &empty;
+    length = 0;
+    return;
+  }
+
+  void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // The mapping keeps its own reference to the file
+  ::close(fd);
+
+  if (p == MAP_FAILED)
+    throw std::runtime_error("Failed mapping " + filename);
+
+  // Captures are consumed front to back: let the kernel read ahead aggressively
+  // and drop pages behind us.
+  madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+  addr = static_cast<const uint8_t*>(p);
+  length = st.st_size;
+}
+
+void MappedFile::close()
+{
+  if (addr != nullptr && length > 0)
+    munmap(const_cast<uint8_t*>(addr), length);
+
+  addr = nullptr;
+  length = 0;
+}
+
+std::span<const uint8_t> MappedFile::region(size_t offset, size_t len) const
+{
+  if (!is_open())
+    throw std::runtime_error("File not opened");
+
+  if (offset > length || len > length - offset)
+    throw std::runtime_error("Unexpected end of file");
+
+  return data().subspan(offset, len);
+}
+
+void MappedFile::prefetch(size_t offset, size_t len) const
+{
+  if (offset >= length || len == 0)
+    return;
+
+  len = std::min(len, length - offset);
+
+  // madvise wants a page aligned address
+  const size_t page = sysconf(_SC_PAGESIZE);
+  const size_t aligned = offset - offset % page;
+
+  // Only a hint: failures are harmless
+  madvise(const_cast<uint8_t*>(addr) + aligned, len + offset - aligned, MADV_WILLNEED);
+}
+
+void load_pages(std::span<const uint8_t> region)
+{
+  if (region.empty())
+    return;
+
+  const size_t page = sysconf(_SC_PAGESIZE);
+
+  // Start the reads for the whole region at once, then wait for them page by page
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(region.data());
+  const uintptr_t aligned = begin - begin % page;
+  madvise(reinterpret_cast<void*>(aligned), region.size() + begin - aligned, MADV_WILLNEED);
+
+  volatile uint8_t sink = 0;
+  for (size_t i = 0; i < region.size(); i += page)
+    sink = sink + region[i];
+  sink = sink + region.back();
+}
+
+void release_pages(std::span<const uint8_t> region)
+{
+  const size_t page = sysconf(_SC_PAGESIZE);
+
+  // Pages shared with the neighbouring regions are left alone, they may still be converted
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(region.data());
+  const uintptr_t first = (begin + page - 1) / page * page;
+  const uintptr_t last = (begin + region.size()) / page * page;
+
+  if (last > first)
+    madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+}
@@ -0,0 +1,60 @@
+#ifndef MAPPED_FILE_HPP_
+#define MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Read-only memory mapping of a whole capture file.
+// Readers take spans over the mapping, so samples are consumed straight from the page cache
+// instead of being copied through a stream buffer first.
+class MappedFile
+{
+  public:
+
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& filename);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    void open(const std::string& filename);
+
+    void close();
+
+    bool is_open() const { return addr != nullptr; }
+
+    size_t size() const { return length; }
+
+    std::span<const uint8_t> data() const { return { addr, length }; }
+
+    // Bounds-checked view of [offset, offset + len). Throws if the file is too short.
+    std::span<const uint8_t> region(size_t offset, size_t len) const;
+
+    // Asks the kernel to start reading [offset, offset + len) in the background.
+    // Useful when several distant regions are consumed at the same time, which defeats readahead.
+    void prefetch(size_t offset, size_t len) const;
+
+  private:
+
+    const uint8_t* addr = nullptr;
+
+    size_t length = 0;
+};
+
+// Blocks until every page of region is resident, by touching each of them.
+// Run ahead of the consumer, so that page faults are not taken while converting.
+void load_pages(std::span<const uint8_t> region);
+
+// Drops the pages lying entirely within region from the process, once they are no longer needed.
+// They stay in the page cache: touching them again faults them back in.
+void release_pages(std::span<const uint8_t> region);
+
+#endif // MAPPED_FILE_HPP_
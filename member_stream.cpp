@@ -0,0 +1,132 @@
+#include "member_stream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+BlockStream::BlockStream(std::function<std::span<const std::byte>()> next_block)
+: next_block(std::move(next_block))
+{
+}
+
+size_t BlockStream::read(std::span<std::byte> out)
+{
+  size_t written = 0;
+
+  while (written < out.size())
+  {
+    if (pending.empty())
+    {
+      pending = next_block();
+      if (pending.empty())
+        break;
+    }
+
+    const size_t n = std::min(pending.size(), out.size() - written);
+    std::memcpy(out.data() + written, pending.data(), n);
+
+    pending = pending.subspan(n);
+    written += n;
+  }
+
+  return written;
+}
+
+member_source_t analogMember(const SiglentAnalogReader& reader, size_t samples, const AnalogLut& lut, size_t oversample)
+{
+  samples = std::min(samples, reader.remaining());
+
+  auto open = [reader, samples, lut, oversample] () -> MemberProducer
+  {
+    struct state_t {
+      SiglentAnalogReader reader;
+      size_t left;
+      std::vector<float> block;
+    };
+
+    // Heavily oversampled channels convert fewer codes per block, to keep the block size bounded
+    const size_t codes_per_block = std::max<size_t>(1, STREAM_BLOCK_SAMPLES / oversample);
+
+    auto state = std::make_shared<state_t>(state_t{ reader, samples, std::vector<float>(codes_per_block * oversample) });
+
+    auto stream = std::make_shared<BlockStream>([state, lut, oversample, codes_per_block] ()
+    {
+      auto codes = state->reader.chunk(std::min(codes_per_block, state->left));
+      state->left -= codes.size();
+
+      auto out = std::span(state->block).first(codes.size() * oversample);
+      lut.convert(codes, oversample, out);
+
+      return std::as_bytes(out);
+    });
+
+    return [stream] (std::span<std::byte> out) { return stream->read(out); };
+  };
+
+  return { samples * oversample * sizeof(float), open, { reader.peek(samples) } };
+}
+
+member_source_t logicMember(const SiglentDigitalReader& reader, size_t samples)
+{
+  samples = std::min(samples - samples % 8, reader.remaining());
+
+  auto open = [reader, samples] () -> MemberProducer
+  {
+    struct state_t {
+      SiglentDigitalReader reader;
+      size_t left;
+      std::vector<uint16_t> block;
+    };
+
+    auto state = std::make_shared<state_t>(state_t{ reader, samples, std::vector<uint16_t>(STREAM_BLOCK_SAMPLES) });
+
+    auto stream = std::make_shared<BlockStream>([state] ()
+    {
+      auto out = std::span(state->block).first(std::min(STREAM_BLOCK_SAMPLES, state->left));
+      out = out.first(state->reader.chunk(out));
+      state->left -= out.size();
+
+      return std::as_bytes(out);
+    });
+
+    return [stream] (std::span<std::byte> out) { return stream->read(out); };
+  };
+
+  return { samples * sizeof(uint16_t), open, reader.peek(samples) };
+}
+
+member_source_t trimMember(member_source_t member, size_t skip, size_t size)
+{
+  if (skip + size > member.size)
+    throw std::runtime_error("Trimmed range out of the member");
+
+  if (skip == 0 && size == member.size)
+    return member;
+
+  auto open = [inner = std::move(member.open), skip, size] () -> MemberProducer
+  {
+    auto producer = inner();
+
+    // At most one sample short of a reader unit: dropped once, when the member starts
+    std::vector<std::byte> head(skip);
+    for (size_t done = 0; done < head.size(); )
+    {
+      const size_t n = producer(std::span(head).subspan(done));
+      if (n == 0)
+        throw std::runtime_error("Member data ended before its declared size");
+      done += n;
+    }
+
+    return [producer = std::move(producer), left = size] (std::span<std::byte> out) mutable {
+      const size_t n = producer(out.first(std::min(out.size(), left)));
+      left -= n;
+      return n;
+    };
+  };
+
+  member.size = size;
+  member.open = std::move(open);
+  return member;
+}
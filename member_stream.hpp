@@ -0,0 +1,65 @@
+#ifndef MEMBER_STREAM_HPP_
+#define MEMBER_STREAM_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "srzip.hpp"
+#include "analog_convert.hpp"
+#include "compression.hpp"
+
+// Converted samples are produced this many at a time while an archive member is written
+const size_t STREAM_BLOCK_SAMPLES = 0x10000;
+
+// Fills out with the next bytes of a member and returns how many were written, 0 once it is over.
+// Reads may be of any size, they need not follow sample boundaries.
+using MemberProducer = std::function<size_t(std::span<std::byte> out)>;
+
+// Creates a member producer: called only when the member is actually written,
+// so no state nor buffer is held for members waiting their turn.
+using MemberFactory = std::function<MemberProducer()>;
+
+struct member_source_t {
+  // Uncompressed size, known before any data is produced
+  size_t size;
+
+  MemberFactory open;
+
+  // Regions of the capture the member is converted from
+  std::vector<std::span<const uint8_t>> input;
+
+  compression_t compression = compression_t::DEFAULT;
+};
+
+// Serves consecutive blocks as a byte stream, whatever the read size.
+// next_block returns a view of the next block, valid until the following call, empty at the end.
+class BlockStream
+{
+  public:
+
+    explicit BlockStream(std::function<std::span<const std::byte>()> next_block);
+
+    size_t read(std::span<std::byte> out);
+
+  private:
+
+    std::function<std::span<const std::byte>()> next_block;
+
+    std::span<const std::byte> pending;
+};
+
+// The next samples of reader, converted to volts: the reader is copied, the original is left untouched.
+member_source_t analogMember(const SiglentAnalogReader& reader, size_t samples, const AnalogLut& lut, size_t oversample);
+
+// The next samples of reader (a multiple of 8), as 16 bit logic samples
+member_source_t logicMember(const SiglentDigitalReader& reader, size_t samples);
+
+// Bytes [skip, skip + size) of member: ranges not aligned on what readers produce
+// (whole octets of logic samples, whole replicas of oversampled analog samples)
+// are converted from the enclosing range, the bytes around them dropped.
+member_source_t trimMember(member_source_t member, size_t skip, size_t size);
+
+#endif // MEMBER_STREAM_HPP_
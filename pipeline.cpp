@@ -0,0 +1,206 @@
+#include "pipeline.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "mapped_file.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point t)
+{
+  return std::chrono::duration<double>(clock_type::now() - t).count();
+}
+
+ConversionPipeline::ConversionPipeline(std::vector<member_source_t> members, ThreadPool& pool, size_t queue_depth)
+: members(std::move(members)),
+pool(pool),
+queue_depth(std::max<size_t>(queue_depth, 1)),
+results(this->members.size())
+{
+}
+
+ConversionPipeline::~ConversionPipeline()
+{
+  stop();
+}
+
+void ConversionPipeline::start()
+{
+  started = clock_type::now();
+
+  reader = std::thread(&ConversionPipeline::read_stage, this);
+}
+
+void ConversionPipeline::stop()
+{
+  {
+    std::lock_guard lock(m);
+    stopping = true;
+  }
+  changed.notify_all();
+
+  if (reader.joinable())
+    reader.join();
+
+  // Queued tasks still refer to this pipeline: they skip their member, but must have run
+  std::unique_lock lock(m);
+  changed.wait(lock, [this] { return pending_tasks == 0; });
+}
+
+void ConversionPipeline::fail(std::exception_ptr e)
+{
+  {
+    std::lock_guard lock(m);
+    if (!error)
+      error = e;
+    stopping = true;
+  }
+  changed.notify_all();
+}
+
+void ConversionPipeline::release_window()
+{
+  {
+    std::lock_guard lock(m);
+    in_flight--;
+  }
+  changed.notify_all();
+}
+
+void ConversionPipeline::read_stage()
+{
+  try {
+    for (size_t i = 0; i < members.size(); i++)
+    {
+      // Wait for the writer to release a member before starting a new one
+      {
+        std::unique_lock lock(m);
+        changed.wait(lock, [this] { return stopping || in_flight < queue_depth; });
+        if (stopping)
+          return;
+        in_flight++;
+      }
+
+      auto t = clock_type::now();
+      for (const auto& region : members[i].input)
+        load_pages(region);
+      read_busy += seconds_since(t);
+
+      {
+        std::lock_guard lock(m);
+        if (stopping)
+          return;
+        pending_tasks++;
+      }
+
+      // Tasks run in submission order: the member the writer waits for is always the first to be worked on
+      pool.submit([this, i] {
+        convert_member(i);
+
+        std::lock_guard lock(m);
+        pending_tasks--;
+        changed.notify_all();
+      });
+    }
+  } catch (...) {
+    fail(std::current_exception());
+  }
+}
+
+void ConversionPipeline::convert_member(size_t i)
+{
+  {
+    std::lock_guard lock(m);
+    if (stopping)
+      return;
+  }
+
+  try {
+    // Owned by the pool thread, reused for every member of every pipeline it works for
+    thread_local MemberCompressor compressor;
+    thread_local std::vector<std::byte> block(PIPELINE_BLOCK_BYTES);
+
+    const auto& member = members[i];
+
+    auto t = clock_type::now();
+    MemberProducer producer = member.open();
+    compressor.begin(member.size, member.compression);
+    convert_busy += seconds_since(t);
+
+    for (size_t left = member.size; left > 0; )
+    {
+      t = clock_type::now();
+      size_t n = producer(std::span(block).first(std::min(left, block.size())));
+      convert_busy += seconds_since(t);
+
+      if (n == 0)
+        throw std::runtime_error("Member data ended before its declared size");
+
+      t = clock_type::now();
+      compressor.update(std::span(block).first(n));
+      compress_busy += seconds_since(t);
+
+      left -= n;
+    }
+
+    // Capture pages are not needed anymore, only the compressed member counts against memory
+    for (const auto& region : member.input)
+      release_pages(region);
+
+    t = clock_type::now();
+    auto compressed = std::shared_ptr<const compressed_member_t>(
+      new compressed_member_t(compressor.finish()),
+      [this] (const compressed_member_t* p) { delete p; release_window(); });
+    compress_busy += seconds_since(t);
+
+    publish(i, std::move(compressed));
+  } catch (...) {
+    fail(std::current_exception());
+  }
+}
+
+void ConversionPipeline::publish(size_t i, std::shared_ptr<const compressed_member_t> member)
+{
+  {
+    std::lock_guard lock(m);
+    results[i] = std::move(member);
+  }
+  changed.notify_all();
+}
+
+std::shared_ptr<const compressed_member_t> ConversionPipeline::take(size_t i)
+{
+  auto t = clock_type::now();
+
+  std::unique_lock lock(m);
+  changed.wait(lock, [this, i] { return stopping || results[i]; });
+
+  write_wait += seconds_since(t);
+
+  if (!results[i])
+    throw std::runtime_error("Conversion pipeline stopped");
+
+  return std::move(results[i]);
+}
+
+void ConversionPipeline::finish()
+{
+  const double wall = seconds_since(started);
+
+  stop();
+
+  if (wall > 0)
+  {
+    const double workers = wall * pool.size();
+
+    spdlog::info("Pipeline: {:.2f} s, stage utilization read {:.0f}%, convert {:.0f}%, compress {:.0f}% ({} workers), write {:.0f}%",
+      wall, 100 * read_busy / wall, 100 * convert_busy / workers, 100 * compress_busy / workers, pool.size(),
+      100 * std::max(0.0, wall - write_wait) / wall);
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+}
@@ -0,0 +1,105 @@
+#ifndef PIPELINE_HPP_
+#define PIPELINE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "member_stream.hpp"
+#include "compression.hpp"
+#include "utils/thread_pool.hpp"
+
+// Converted data is handed to the compressor in blocks of this size
+const size_t PIPELINE_BLOCK_BYTES = 1 << 20;
+
+// Default number of members in flight between the read stage and the writer
+const size_t PIPELINE_QUEUE_DEPTH = 8;
+
+// Runs the conversion of a list of members as concurrent stages:
+//  read:     faults in the capture pages each member is converted from
+//  convert + compress: one pool task per member, running its producer
+//            and deflating the output into a self-contained compressed member
+//  write:    the archive writer copying compressed members, in order, through take()
+// Members are converted and compressed concurrently (several chunks of a channel, several channels)
+// but always come out in order. At most queue_depth members are in flight between the read stage
+// and the writer, which bounds memory.
+// The pool may be shared by several pipelines converting different captures at once:
+// their member tasks interleave, and conversion buffers belong to the pool threads.
+class ConversionPipeline
+{
+  public:
+
+    ConversionPipeline(std::vector<member_source_t> members, ThreadPool& pool, size_t queue_depth = PIPELINE_QUEUE_DEPTH);
+
+    ConversionPipeline(const ConversionPipeline&) = delete;
+    ConversionPipeline& operator=(const ConversionPipeline&) = delete;
+
+    ~ConversionPipeline();
+
+    void start();
+
+    // Member i once compressed, waiting for it if needed. To be called once per member, in order.
+    // Dropping the returned pointer lets the read stage move on to a new member.
+    std::shared_ptr<const compressed_member_t> take(size_t i);
+
+    // Stops every stage, reports how busy each one was, and rethrows the first stage failure
+    void finish();
+
+  private:
+
+    void read_stage();
+
+    void convert_member(size_t i);
+
+    void publish(size_t i, std::shared_ptr<const compressed_member_t> member);
+
+    void release_window();
+
+    void fail(std::exception_ptr e);
+
+    void stop();
+
+    const std::vector<member_source_t> members;
+
+    ThreadPool& pool;
+
+    const size_t queue_depth;
+
+    std::thread reader;
+
+    // Guards everything below
+    std::mutex m;
+
+    std::condition_variable changed;
+
+    bool stopping = false;
+
+    std::exception_ptr error;
+
+    // Members read but not yet released by the writer
+    size_t in_flight = 0;
+
+    // Member tasks submitted to the pool and not yet over
+    size_t pending_tasks = 0;
+
+    // Compressed members waiting for the writer.
+    // Declared last: releasing them on destruction still needs the members above.
+    std::vector<std::shared_ptr<const compressed_member_t>> results;
+
+    std::chrono::steady_clock::time_point started;
+
+    // Time each stage spent working, not waiting on its queues
+    std::atomic<double> read_busy = 0;
+    std::atomic<double> convert_busy = 0;
+    std::atomic<double> compress_busy = 0;
+    std::atomic<double> write_wait = 0;
+};
+
+#endif // PIPELINE_HPP_
@@ -1,54 +1,83 @@
 #include "siglent_bin.hpp"
 
-#include "utils/stream.hpp"
+#include "header_layout.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 float header_t::unit_value_t::get_value() const
 {
   return value;
 }
 
-static header_t::unit_value_t from_bin(std::ifstream& stream) {
-  header_t::unit_value_t unit;
-  unit.value = deserialize<double>(stream);
-  unit.magnitude = deserialize<magnitude_t>(stream);
-  unit.unit = deserialize<unit_t>(stream);
-  return unit;
+// Short captures read as if padded with zeros
+static std::array<uint8_t, HEADER_SIZE> header_bytes(std::span<const uint8_t> data)
+{
+  std::array<uint8_t, HEADER_SIZE> buffer = {};
+  std::copy_n(data.begin(), std::min(data.size(), HEADER_SIZE), buffer.begin());
+  return buffer;
+}
+
+header_t parse(std::span<const uint8_t> data) {
+  return decode_header<SDS1000XE_LAYOUT>(header_bytes(data));
 }
 
 header_t parse(std::ifstream& stream) {
-  header_t h;
+  std::array<uint8_t, HEADER_SIZE> buffer;
+  stream.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
 
-  for (size_t i = 0; i < MAX_ANALOG_CHANNELS; i++)
-    h.analog_ch_on[i] = deserialize<uint32_t>(stream);
+  return parse(std::span(buffer).first(stream.gcount()));
+}
 
-  for (size_t i = 0; i < MAX_ANALOG_CHANNELS; i++)
-    h.analog_scales[i] = from_bin(stream);
+header_t parse(const MappedFile& file)
+{
+  return parse(file.data());
+}
 
-  for (size_t i = 0; i < MAX_ANALOG_CHANNELS; i++)
-    h.analog_offsets[i] = from_bin(stream);
+size_t read_siglent_header(const std::string& filename, std::span<uint8_t, HEADER_SIZE> out)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Failed opening " + filename);
 
-  h.digital_on = deserialize<uint32_t>(stream);
+  // A single read: scanning many captures for their headers costs one syscall each
+  const ssize_t n = ::read(fd, out.data(), out.size());
+  const int error = errno;
+  ::close(fd);
 
-  for (size_t i = 0; i < MAX_DIGITAL_PROBES; i++)
-    h.digital_ch_on[i] = deserialize<uint32_t>(stream);
+  if (n < 0)
+    throw std::runtime_error("Failed reading " + filename + ": " + std::strerror(error));
 
-  h.time_div = from_bin(stream);
+  return n;
+}
 
-  h.time_delay = from_bin(stream);
+header_t parse_siglent_header_file(const std::string& filename)
+{
+  std::array<uint8_t, HEADER_SIZE> buffer;
+  const size_t n = read_siglent_header(filename, buffer);
 
-  h.analog_size = deserialize<uint32_t>(stream);
+  return parse(std::span(buffer).first(n));
+}
 
-  h.analog_sample_rate = from_bin(stream);
+std::vector<std::string> validate_header(std::span<const uint8_t> data)
+{
+  std::vector<std::string> problems;
 
-  h.digital_size = deserialize<uint32_t>(stream);
+  if (data.size() < HEADER_SIZE)
+    problems.push_back("header truncated: " + std::to_string(data.size()) + " of " + std::to_string(HEADER_SIZE) + " bytes");
 
-  h.digital_sample_rate = from_bin(stream);
+  for (auto& problem : validate_fields<SDS1000XE_LAYOUT>(header_bytes(data)))
+    problems.push_back(std::move(problem));
 
-  return h;
+  return problems;
 }
 
-header_t parse_siglent_header_file(const std::string& filename)
+std::string dump_header(std::span<const uint8_t> data)
 {
-  std::ifstream f(filename);
-  return parse(f);
+  return dump_fields<SDS1000XE_LAYOUT>(header_bytes(data));
 }
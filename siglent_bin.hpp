@@ -4,11 +4,19 @@
 #include <inttypes.h>
 #include <fstream>
 #include <array>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
 
 const int MAX_DIGITAL_PROBES = 16;
 const int MAX_ANALOG_CHANNELS = 4;
 const int DATA_OFFSET = 0x800;
 
+// Bytes of the header actually decoded, from the start of the file
+const size_t HEADER_SIZE = 0x11c;
+
 enum class magnitude_t : uint32_t {
   YOCTO,
   ZEPTO,
@@ -90,8 +98,23 @@ struct header_t {
   unit_value_t digital_sample_rate;
 };
 
+// Decodes the header from the first bytes of a capture; missing bytes read as zeros
+header_t parse(std::span<const uint8_t> data);
+
 header_t parse(std::ifstream& stream);
 
+// Header of an already mapped capture, shared with its data readers
+header_t parse(const MappedFile& file);
+
+// Reads the first HEADER_SIZE bytes of a capture at most, returns how many were read
+size_t read_siglent_header(const std::string& filename, std::span<uint8_t, HEADER_SIZE> out);
+
 header_t parse_siglent_header_file(const std::string& filename);
 
+// Values of the header no oscilloscope writes, one message each: empty for a sane header
+std::vector<std::string> validate_header(std::span<const uint8_t> data);
+
+// Every header field with its offset and raw value, one per line
+std::string dump_header(std::span<const uint8_t> data);
+
 #endif  // SIGLENT_BIN_HPP_
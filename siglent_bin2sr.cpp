@@ -0,0 +1,471 @@
+#include "siglent_bin2sr.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include "siglent_bin.hpp"
+#include "srzip.hpp"
+#include "analog_convert.hpp"
+#include "mapped_file.hpp"
+#include "srzip_writer.hpp"
+#include "conversion.hpp"
+#include "utils/thread_pool.hpp"
+
+// Handles are the C++ objects themselves, behind opaque C types
+
+struct sb2sr_capture {
+  header_t header;
+  std::shared_ptr<const MappedFile> file;
+};
+
+struct sb2sr_analog_reader {
+  SiglentAnalogReader reader;
+  AnalogLut lut;
+};
+
+struct sb2sr_logic_reader {
+  SiglentDigitalReader reader;
+};
+
+struct sb2sr_writer {
+  SrzipWriter writer;
+};
+
+struct sb2sr_converter {
+  conversion_options_t options;
+  ThreadPool pool;
+};
+
+// Exceptions never cross the C interface: they end up here
+static thread_local std::string last_error;
+
+namespace {
+
+// Rejected arguments, reported as SB2SR_INVALID_ARGUMENT
+struct invalid_argument : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+template<typename F>
+int guarded(F&& f)
+{
+  try {
+    f();
+    last_error.clear();
+    return SB2SR_OK;
+  } catch (const invalid_argument& e) {
+    last_error = e.what();
+    return SB2SR_INVALID_ARGUMENT;
+  } catch (const std::exception& e) {
+    last_error = e.what();
+    return SB2SR_ERROR;
+  } catch (...) {
+    last_error = "Unknown error";
+    return SB2SR_ERROR;
+  }
+}
+
+void require(bool condition, const char* what)
+{
+  if (!condition)
+    throw invalid_argument(what);
+}
+
+compression_t to_compression(sb2sr_compression compression)
+{
+  switch (compression)
+  {
+    case SB2SR_STORE: return compression_t::STORE;
+    case SB2SR_FAST: return compression_t::FAST;
+    case SB2SR_DEFAULT: return compression_t::DEFAULT;
+    case SB2SR_BEST: return compression_t::BEST;
+  }
+  throw invalid_argument("Unknown compression");
+}
+
+sb2sr_compression from_compression(compression_t compression)
+{
+  switch (compression)
+  {
+    case compression_t::STORE: return SB2SR_STORE;
+    case compression_t::FAST: return SB2SR_FAST;
+    case compression_t::DEFAULT: return SB2SR_DEFAULT;
+    case compression_t::BEST: return SB2SR_BEST;
+  }
+  throw std::logic_error("Unknown compression");
+}
+
+conversion_options_t to_options(const sb2sr_options* options)
+{
+  conversion_options_t o;
+  if (!options)
+    return o;
+
+  if (options->jobs > 0)
+    o.jobs = options->jobs;
+  if (options->queue_depth > 0)
+    o.queue_depth = options->queue_depth;
+  o.chunk_samples = options->chunk_samples;
+  o.max_memory = options->max_memory;
+  o.analog_compression = to_compression(options->analog_compression);
+  o.logic_compression = to_compression(options->logic_compression);
+  return o;
+}
+
+void to_header(const header_t& h, sb2sr_header* out)
+{
+  *out = {};
+
+  for (size_t i = 0; i < MAX_ANALOG_CHANNELS; i++)
+  {
+    out->analog_on[i] = h.analog_ch_on[i];
+    out->analog_scale[i] = h.analog_scales[i].value;
+    out->analog_offset[i] = h.analog_offsets[i].value;
+  }
+
+  out->digital_on = h.digital_on;
+  for (size_t i = 0; i < MAX_DIGITAL_PROBES; i++)
+    out->digital_probe_on[i] = h.digital_ch_on[i];
+
+  out->time_div = h.time_div.value;
+  out->time_delay = h.time_delay.value;
+  out->analog_size = h.analog_size;
+  out->analog_sample_rate = h.analog_sample_rate.value;
+  out->digital_size = h.digital_size;
+  out->digital_sample_rate = h.digital_sample_rate.value;
+}
+
+// Forwards log messages to the callback registered through the C interface
+class callback_sink : public spdlog::sinks::base_sink<std::mutex>
+{
+  public:
+
+    callback_sink(sb2sr_log_fn callback, void* user)
+    : callback(callback),
+    user(user)
+    {
+    }
+
+  protected:
+
+    void sink_it_(const spdlog::details::log_msg& msg) override
+    {
+      const std::string message(msg.payload.data(), msg.payload.size());
+      const auto level = msg.level >= spdlog::level::err && msg.level < spdlog::level::off ?
+        SB2SR_LOG_ERROR : sb2sr_log_level(msg.level);
+      callback(user, level, message.c_str());
+    }
+
+    void flush_() override
+    {
+    }
+
+  private:
+
+    const sb2sr_log_fn callback;
+
+    void* const user;
+};
+
+}
+
+extern "C" {
+
+unsigned sb2sr_api_version(void)
+{
+  return SB2SR_API_VERSION;
+}
+
+const char* sb2sr_last_error(void)
+{
+  return last_error.c_str();
+}
+
+void sb2sr_set_log_callback(sb2sr_log_fn callback, void* user)
+{
+  std::shared_ptr<spdlog::logger> logger;
+  if (callback)
+    logger = std::make_shared<spdlog::logger>("", std::make_shared<callback_sink>(callback, user));
+  else
+    logger = std::make_shared<spdlog::logger>("", std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+
+  logger->set_level(spdlog::default_logger()->level());
+  spdlog::set_default_logger(std::move(logger));
+}
+
+void sb2sr_set_log_level(sb2sr_log_level level)
+{
+  spdlog::set_level(spdlog::level::level_enum(level));
+}
+
+int sb2sr_parse_header_file(const char* path, sb2sr_header* header)
+{
+  return guarded([&] {
+    require(path && header, "Null argument");
+    to_header(parse_siglent_header_file(path), header);
+  });
+}
+
+int sb2sr_capture_open(const char* path, sb2sr_capture** capture)
+{
+  return guarded([&] {
+    require(path && capture, "Null argument");
+    *capture = nullptr;
+
+    auto c = std::make_unique<sb2sr_capture>();
+    c->file = std::make_shared<const MappedFile>(path);
+    c->header = parse(*c->file);
+    *capture = c.release();
+  });
+}
+
+int sb2sr_capture_header(const sb2sr_capture* capture, sb2sr_header* header)
+{
+  return guarded([&] {
+    require(capture && header, "Null argument");
+    to_header(capture->header, header);
+  });
+}
+
+void sb2sr_capture_close(sb2sr_capture* capture)
+{
+  delete capture;
+}
+
+int sb2sr_analog_reader_open(const sb2sr_capture* capture, unsigned channel, sb2sr_analog_reader** reader)
+{
+  return guarded([&] {
+    require(capture && reader, "Null argument");
+    *reader = nullptr;
+
+    const header_t& h = capture->header;
+    require(channel < MAX_ANALOG_CHANNELS && h.analog_ch_on[channel], "Analog channel not in the capture");
+
+    // Active channels are stored one after the other, in channel order
+    const size_t active_before = std::count(h.analog_ch_on.begin(), h.analog_ch_on.begin() + channel, true);
+
+    auto r = std::make_unique<sb2sr_analog_reader>(sb2sr_analog_reader{
+      SiglentAnalogReader(DATA_OFFSET + active_before * h.analog_size, h.analog_size),
+      AnalogLut(h, channel) });
+    r->reader.open(capture->file);
+    *reader = r.release();
+  });
+}
+
+int64_t sb2sr_analog_read(sb2sr_analog_reader* reader, float* out, size_t count)
+{
+  int64_t read = 0;
+
+  const int status = guarded([&] {
+    require(reader && (out || count == 0), "Null argument");
+
+    auto in = reader->reader.chunk(count);
+    reader->lut.convert(in, 1, std::span(out, in.size()));
+    read = in.size();
+  });
+
+  return status == SB2SR_OK ? read : status;
+}
+
+int sb2sr_analog_skip(sb2sr_analog_reader* reader, uint64_t count)
+{
+  return guarded([&] {
+    require(reader, "Null argument");
+    reader->reader.skip(std::min<uint64_t>(count, reader->reader.remaining()));
+  });
+}
+
+uint64_t sb2sr_analog_remaining(const sb2sr_analog_reader* reader)
+{
+  return reader ? reader->reader.remaining() : 0;
+}
+
+void sb2sr_analog_reader_close(sb2sr_analog_reader* reader)
+{
+  delete reader;
+}
+
+int sb2sr_logic_reader_open(const sb2sr_capture* capture, sb2sr_logic_reader** reader)
+{
+  return guarded([&] {
+    require(capture && reader, "Null argument");
+    *reader = nullptr;
+
+    const header_t& h = capture->header;
+    require(h.digital_on, "No digital probe in the capture");
+
+    // Probe planes follow every active analog channel
+    const size_t analog_channels = std::count(h.analog_ch_on.begin(), h.analog_ch_on.end(), true);
+    const size_t probes = std::count_if(h.digital_ch_on.begin(), h.digital_ch_on.end(), [] (uint32_t on) { return on != 0; });
+
+    auto r = std::make_unique<sb2sr_logic_reader>(sb2sr_logic_reader{
+      SiglentDigitalReader(DATA_OFFSET + analog_channels * h.analog_size, probes, h.digital_size / 8) });
+    r->reader.open(capture->file);
+    *reader = r.release();
+  });
+}
+
+int64_t sb2sr_logic_read(sb2sr_logic_reader* reader, uint16_t* out, size_t count)
+{
+  int64_t read = 0;
+
+  const int status = guarded([&] {
+    require(reader && out, "Null argument");
+    require(count >= 8, "Logic samples are read by whole octets");
+
+    read = reader->reader.chunk(std::span(out, count));
+  });
+
+  return status == SB2SR_OK ? read : status;
+}
+
+int sb2sr_logic_skip(sb2sr_logic_reader* reader, uint64_t count)
+{
+  return guarded([&] {
+    require(reader, "Null argument");
+    require(count % 8 == 0, "Logic samples are skipped by whole octets");
+    reader->reader.skip(count);
+  });
+}
+
+uint64_t sb2sr_logic_remaining(const sb2sr_logic_reader* reader)
+{
+  return reader ? reader->reader.remaining() : 0;
+}
+
+void sb2sr_logic_reader_close(sb2sr_logic_reader* reader)
+{
+  delete reader;
+}
+
+int sb2sr_writer_open(const char* path, sb2sr_writer** writer)
+{
+  return guarded([&] {
+    require(path && writer, "Null argument");
+    *writer = nullptr;
+    *writer = new sb2sr_writer{ SrzipWriter(path) };
+  });
+}
+
+int sb2sr_writer_add(sb2sr_writer* writer, const char* name, const void* data, size_t size, sb2sr_compression compression)
+{
+  return guarded([&] {
+    require(writer && name && (data || size == 0), "Null argument");
+
+    member_source_t source;
+    source.size = size;
+    source.compression = to_compression(compression);
+    source.open = [data, size] {
+      return [in = std::span(static_cast<const std::byte*>(data), size)] (std::span<std::byte> out) mutable {
+        const size_t n = std::min(out.size(), in.size());
+        std::memcpy(out.data(), in.data(), n);
+        in = in.subspan(n);
+        return n;
+      };
+    };
+
+    writer->writer.add(name, std::move(source));
+  });
+}
+
+int sb2sr_writer_add_stream(sb2sr_writer* writer, const char* name, uint64_t size,
+  sb2sr_read_fn read, void* user, sb2sr_compression compression)
+{
+  return guarded([&] {
+    require(writer && name && read, "Null argument");
+
+    member_source_t source;
+    source.size = size;
+    source.compression = to_compression(compression);
+    source.open = [read, user, size] {
+      return [read, user, left = size] (std::span<std::byte> out) mutable -> size_t {
+        if (left == 0)
+          return 0;
+
+        const int64_t n = read(user, out.data(), std::min<uint64_t>(out.size(), left));
+        if (n < 0)
+          throw std::runtime_error("Member source failed");
+        if (n == 0)
+          throw std::runtime_error("Member data ended before its declared size");
+
+        left -= n;
+        return n;
+      };
+    };
+
+    writer->writer.add(name, std::move(source));
+  });
+}
+
+int sb2sr_writer_close(sb2sr_writer* writer)
+{
+  const std::unique_ptr<sb2sr_writer> owned(writer);
+
+  return guarded([&] {
+    require(writer, "Null argument");
+    writer->writer.close();
+  });
+}
+
+void sb2sr_writer_discard(sb2sr_writer* writer)
+{
+  // Never closed: the archive is removed
+  delete writer;
+}
+
+void sb2sr_default_options(sb2sr_options* options)
+{
+  if (!options)
+    return;
+
+  const conversion_options_t defaults;
+  *options = {};
+  options->jobs = defaults.jobs;
+  options->queue_depth = defaults.queue_depth;
+  options->chunk_samples = defaults.chunk_samples;
+  options->max_memory = defaults.max_memory;
+  options->analog_compression = from_compression(defaults.analog_compression);
+  options->logic_compression = from_compression(defaults.logic_compression);
+}
+
+int sb2sr_convert(const char* in_path, const char* out_path, const sb2sr_options* options)
+{
+  return guarded([&] {
+    require(in_path && out_path, "Null argument");
+    convertCapture(in_path, out_path, to_options(options));
+  });
+}
+
+int sb2sr_converter_create(const sb2sr_options* options, sb2sr_converter** converter)
+{
+  return guarded([&] {
+    require(converter, "Null argument");
+    *converter = nullptr;
+
+    const conversion_options_t o = to_options(options);
+    *converter = new sb2sr_converter{ o, ThreadPool(o.jobs) };
+  });
+}
+
+int sb2sr_converter_run(sb2sr_converter* converter, const char* in_path, const char* out_path)
+{
+  return guarded([&] {
+    require(converter && in_path && out_path, "Null argument");
+    convertCapture(in_path, out_path, converter->options, converter->pool);
+  });
+}
+
+void sb2sr_converter_destroy(sb2sr_converter* converter)
+{
+  delete converter;
+}
+
+}
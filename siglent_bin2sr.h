@@ -0,0 +1,205 @@
+#ifndef SIGLENT_BIN2SR_H_
+#define SIGLENT_BIN2SR_H_
+
+/*
+ * C interface of libsiglentbin2sr: Siglent binary captures parsing, reading and conversion to srzip.
+ *
+ * Functions returning int return SB2SR_OK (0) on success, a negative sb2sr_status on failure;
+ * sb2sr_last_error() then describes the failure. No function throws nor aborts.
+ * Buffers are always supplied by the caller, nothing returned needs to be freed but handles,
+ * each with its own close function.
+ * Handles may be used from any thread, but not from several threads at once.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incremented on incompatible changes of this interface */
+#define SB2SR_API_VERSION 1
+
+typedef enum {
+  SB2SR_OK = 0,
+  /* Conversion, I/O or format error */
+  SB2SR_ERROR = -1,
+  /* Null pointer, channel not in the capture, misaligned position... */
+  SB2SR_INVALID_ARGUMENT = -2
+} sb2sr_status;
+
+/* Zero is the default level: zero-initialized options compress as sb2sr_default_options does */
+typedef enum {
+  SB2SR_DEFAULT = 0,
+  SB2SR_STORE = 1,
+  SB2SR_FAST = 2,
+  SB2SR_BEST = 3
+} sb2sr_compression;
+
+/* SB2SR_API_VERSION the library was built with */
+unsigned sb2sr_api_version(void);
+
+/* Description of the last failure on the calling thread, empty if none */
+const char* sb2sr_last_error(void);
+
+/*
+ * Logging
+ */
+
+typedef enum {
+  SB2SR_LOG_TRACE = 0,
+  SB2SR_LOG_DEBUG = 1,
+  SB2SR_LOG_INFO = 2,
+  SB2SR_LOG_WARN = 3,
+  SB2SR_LOG_ERROR = 4,
+  SB2SR_LOG_OFF = 6
+} sb2sr_log_level;
+
+/* Receives the library log messages, from any thread */
+typedef void (*sb2sr_log_fn)(void* user, sb2sr_log_level level, const char* message);
+
+/* Sends log messages to callback instead of the standard output; NULL restores the standard output */
+void sb2sr_set_log_callback(sb2sr_log_fn callback, void* user);
+
+void sb2sr_set_log_level(sb2sr_log_level level);
+
+/*
+ * Capture header
+ */
+
+#define SB2SR_ANALOG_CHANNELS 4
+#define SB2SR_DIGITAL_PROBES 16
+
+/* Values are in base units: volts, seconds, samples per second */
+typedef struct {
+  uint32_t analog_on[SB2SR_ANALOG_CHANNELS];
+  /* Volts per division */
+  double analog_scale[SB2SR_ANALOG_CHANNELS];
+  double analog_offset[SB2SR_ANALOG_CHANNELS];
+
+  uint32_t digital_on;
+  uint32_t digital_probe_on[SB2SR_DIGITAL_PROBES];
+
+  /* Seconds per division */
+  double time_div;
+  double time_delay;
+
+  /* Samples of each analog channel */
+  uint32_t analog_size;
+  double analog_sample_rate;
+
+  /* Samples of each digital probe */
+  uint32_t digital_size;
+  double digital_sample_rate;
+} sb2sr_header;
+
+int sb2sr_parse_header_file(const char* path, sb2sr_header* header);
+
+/*
+ * Captures and their readers
+ */
+
+typedef struct sb2sr_capture sb2sr_capture;
+
+/* Maps the capture and parses its header */
+int sb2sr_capture_open(const char* path, sb2sr_capture** capture);
+
+int sb2sr_capture_header(const sb2sr_capture* capture, sb2sr_header* header);
+
+/* Readers opened on the capture stay valid after it is closed */
+void sb2sr_capture_close(sb2sr_capture* capture);
+
+typedef struct sb2sr_analog_reader sb2sr_analog_reader;
+
+/* Samples of analog channel (0 to 3, must be on), converted to volts at the analog sample rate */
+int sb2sr_analog_reader_open(const sb2sr_capture* capture, unsigned channel, sb2sr_analog_reader** reader);
+
+/* Reads up to count samples into out, returns how many were read (0 at the end) or a negative sb2sr_status */
+int64_t sb2sr_analog_read(sb2sr_analog_reader* reader, float* out, size_t count);
+
+int sb2sr_analog_skip(sb2sr_analog_reader* reader, uint64_t count);
+
+uint64_t sb2sr_analog_remaining(const sb2sr_analog_reader* reader);
+
+void sb2sr_analog_reader_close(sb2sr_analog_reader* reader);
+
+typedef struct sb2sr_logic_reader sb2sr_logic_reader;
+
+/* Samples of all active digital probes at the digital sample rate, bit n holding the n-th active probe */
+int sb2sr_logic_reader_open(const sb2sr_capture* capture, sb2sr_logic_reader** reader);
+
+/* Reads up to count samples into out, rounded down to a multiple of 8 (count must be at least 8).
+ * Returns how many were read (0 at the end) or a negative sb2sr_status. */
+int64_t sb2sr_logic_read(sb2sr_logic_reader* reader, uint16_t* out, size_t count);
+
+/* count must be a multiple of 8 */
+int sb2sr_logic_skip(sb2sr_logic_reader* reader, uint64_t count);
+
+uint64_t sb2sr_logic_remaining(const sb2sr_logic_reader* reader);
+
+void sb2sr_logic_reader_close(sb2sr_logic_reader* reader);
+
+/*
+ * srzip writer: members are written in the order they are added
+ */
+
+typedef struct sb2sr_writer sb2sr_writer;
+
+/* Fills buffer with up to size bytes of a member, returns how many (0 at the end), negative to abort */
+typedef int64_t (*sb2sr_read_fn)(void* user, void* buffer, size_t size);
+
+int sb2sr_writer_open(const char* path, sb2sr_writer** writer);
+
+/* Member copied from memory */
+int sb2sr_writer_add(sb2sr_writer* writer, const char* name, const void* data, size_t size, sb2sr_compression compression);
+
+/* Member of size bytes produced by read, called until it has produced them all */
+int sb2sr_writer_add_stream(sb2sr_writer* writer, const char* name, uint64_t size,
+  sb2sr_read_fn read, void* user, sb2sr_compression compression);
+
+/* Completes the archive and frees the writer, even on failure */
+int sb2sr_writer_close(sb2sr_writer* writer);
+
+/* Frees the writer and removes the incomplete archive */
+void sb2sr_writer_discard(sb2sr_writer* writer);
+
+/*
+ * Conversion
+ */
+
+/* Every field left to 0 takes its default value: options set to { 0 } convert as sb2sr_default_options ones */
+typedef struct {
+  /* Conversion threads, 0 for one per CPU */
+  size_t jobs;
+  /* Members in flight between reading and writing, 0 for the default */
+  size_t queue_depth;
+  /* Samples per member, 0 to choose from the capture and the machine */
+  size_t chunk_samples;
+  /* Memory budget in bytes, 0 for none */
+  size_t max_memory;
+  /* SB2SR_DEFAULT when 0 */
+  sb2sr_compression analog_compression;
+  sb2sr_compression logic_compression;
+} sb2sr_options;
+
+void sb2sr_default_options(sb2sr_options* options);
+
+/* Converts a capture into an srzip archive, with threads started for this conversion only */
+int sb2sr_convert(const char* in_path, const char* out_path, const sb2sr_options* options);
+
+/* Keeps conversion threads and buffers between conversions */
+typedef struct sb2sr_converter sb2sr_converter;
+
+int sb2sr_converter_create(const sb2sr_options* options, sb2sr_converter** converter);
+
+/* Several conversions may run at once on the same converter, from different threads */
+int sb2sr_converter_run(sb2sr_converter* converter, const char* in_path, const char* out_path);
+
+void sb2sr_converter_destroy(sb2sr_converter* converter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIGLENT_BIN2SR_H_ */
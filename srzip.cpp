@@ -1,13 +1,14 @@
 #include "srzip.hpp"
 
-#include <iostream>
-
-#include <zip.h>
+#include "digital_transpose.hpp"
+#include "siglent_bin.hpp"
 
 #include <vector>
 #include <cstring>
 #include <string>
-#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <array>
 
 SiglentAnalogReader::SiglentAnalogReader(size_t skip, size_t len)
 : seek(skip),
@@ -17,91 +18,115 @@ samples(len)
 
 void SiglentAnalogReader::open(const std::string& filename)
 {
-  f = std::ifstream(filename);
-  if (!f.is_open())
-    throw std::runtime_error("Failed opening in analog read");
+  open(std::make_shared<const MappedFile>(filename));
+}
 
-  f.seekg(seek);
+void SiglentAnalogReader::open(std::shared_ptr<const MappedFile> file)
+{
+  f = std::move(file);
 
-  if (f.eof())
-    throw std::runtime_error("Failed opening in analog read");
+  data = f->region(seek, samples);
 
   offset = 0;
 }
 
-std::vector<uint8_t> SiglentAnalogReader::chunk(size_t chunk_size)
+std::span<const uint8_t> SiglentAnalogReader::chunk(size_t chunk_size)
 {
-  std::vector<uint8_t> ret(std::min(chunk_size, samples - offset));
-
-  // f not opened
-
-  f.read((char*)ret.data(), ret.size() * sizeof(ret[0]));
+  auto ret = data.subspan(offset, std::min(chunk_size, samples - offset));
 
   offset += ret.size();
 
-  // Check if eof?
-
   return ret;
 }
 
+std::span<const uint8_t> SiglentAnalogReader::peek(size_t count) const
+{
+  return data.subspan(offset, std::min(count, samples - offset));
+}
+
+void SiglentAnalogReader::skip(size_t count)
+{
+  offset += std::min(count, samples - offset);
+}
+
 SiglentDigitalReader::SiglentDigitalReader(size_t skip, size_t channels, size_t len)
 : seek(skip),
+channels(channels),
 octets(len)
 {
-  for (size_t i = 0; i < channels; i++)
-    fs.push_back(std::ifstream());
+  if (channels > MAX_DIGITAL_PROBES)
+    throw std::runtime_error("Too many digital channels");
 }
 
 void SiglentDigitalReader::open(const std::string& filename)
 {
-  for (int i = 0; auto& f : fs)
-  {
-    f.open(filename);
-
-    if (!f.is_open())
-      throw std::runtime_error("Failed opening in digital read");
-
-    f.seekg(seek + octets * i);
+  open(std::make_shared<const MappedFile>(filename));
+}
 
-    if (f.eof())
-      throw std::runtime_error("Failed reading in digital read");
+void SiglentDigitalReader::open(std::shared_ptr<const MappedFile> file)
+{
+  f = std::move(file);
 
-    i++;
-  }
+  planes.clear();
+  for (size_t i = 0; i < channels; i++)
+    planes.push_back(f->region(seek + octets * i, octets));
 
-  // Check if eof?
   octets_read = 0;
 }
 
-// With this method, a group of samples of up to chunk_size are read.
+// With this method, a group of samples of up to out.size() are read.
 // These samples will be stored in a single file of .srzip.
 // Each octet from siglent bin gives 8 samples in .srzip.
-std::vector<uint16_t> SiglentDigitalReader::chunk(size_t chunk_size)
+size_t SiglentDigitalReader::chunk(std::span<uint16_t> out)
 {
-  size_t octets_to_be_read = std::min(chunk_size / 8, octets - octets_read);
-
-  std::vector<uint16_t> ret(octets_to_be_read * 8);
+  size_t octets_to_be_read = std::min(out.size() / 8, octets - octets_read);
 
-  std::fill(ret.begin(), ret.end(), 0);
+  // All planes are consumed in lockstep, which sequential readahead cannot follow:
+  // issue one large read per plane for the whole chunk up front.
+  for (size_t channel = 0; channel < channels; channel++)
+    f->prefetch(seek + octets * channel + octets_read, octets_to_be_read);
 
-  // Reads samples in groups of one octect (8 samples)
-  for (int channel = 0; auto& f : fs)
+  // Walk the chunk block by block, merging every channel into the block before moving on
+  std::array<const uint8_t*, MAX_DIGITAL_PROBES> block_planes;
+  for (size_t block = 0; block < octets_to_be_read; block += DIGITAL_BLOCK_OCTETS)
   {
-    std::vector<uint8_t> ch(octets_to_be_read);
-
-    f.read((char*)ch.data(), ch.size());
-    // Check if eof?
+    const size_t block_octets = std::min(DIGITAL_BLOCK_OCTETS, octets_to_be_read - block);
 
-    for (size_t base = 0; base < octets_to_be_read; base++)
-    {
-      for (size_t bit = 0; bit < 8; bit++)
-        ret.at(base * 8 + bit) |= ((((uint16_t)ch.at(base) >> bit) & 0x01) << channel);
-    }
+    for (size_t channel = 0; channel < channels; channel++)
+      block_planes[channel] = planes[channel].data() + octets_read + block;
 
-    channel++;
+    transpose_planes(std::span(block_planes).first(channels), block_octets, out.subspan(block * 8, block_octets * 8));
   }
 
   octets_read += octets_to_be_read;
 
+  return octets_to_be_read * 8;
+}
+
+std::vector<uint16_t> SiglentDigitalReader::chunk(size_t chunk_size)
+{
+  std::vector<uint16_t> ret(std::min(chunk_size / 8, octets - octets_read) * 8);
+
+  chunk(std::span(ret));
+
+  return ret;
+}
+
+void SiglentDigitalReader::skip(size_t count)
+{
+  if (count % 8)
+    throw std::runtime_error("Digital samples can only be skipped by whole octets");
+
+  octets_read += std::min(count / 8, octets - octets_read);
+}
+
+std::vector<std::span<const uint8_t>> SiglentDigitalReader::peek(size_t count) const
+{
+  const size_t n = std::min((count + 7) / 8, octets - octets_read);
+
+  std::vector<std::span<const uint8_t>> ret;
+  for (const auto& plane : planes)
+    ret.push_back(plane.subspan(octets_read, n));
+
   return ret;
 }
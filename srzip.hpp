@@ -2,11 +2,17 @@
 #define SRZIP_HPP_
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
-#include <fstream>
 
-const size_t SAMPLES_LIMIT = 0x280000;
+#include "mapped_file.hpp"
+
+// Digital planes are transposed in blocks of this many octets, so that the output block
+// (8 samples of 16 bits per octet) stays in cache while every channel is merged into it.
+const size_t DIGITAL_BLOCK_OCTETS = 0x2000;
 
 class SiglentAnalogReader
 {
@@ -16,11 +22,24 @@ class SiglentAnalogReader
 
     void open(const std::string& filename);
 
-    std::vector<uint8_t> chunk(size_t chunk_size);
+    // Reads from an already mapped capture, shared with other readers
+    void open(std::shared_ptr<const MappedFile> file);
+
+    // Returned span points into the mapped capture and stays valid as long as the mapping.
+    std::span<const uint8_t> chunk(size_t chunk_size);
+
+    void skip(size_t count);
+
+    size_t remaining() const { return samples - offset; }
+
+    // Input the next count samples will be read from, without consuming them
+    std::span<const uint8_t> peek(size_t count) const;
 
   private:
 
-    std::ifstream f;
+    std::shared_ptr<const MappedFile> f;
+
+    std::span<const uint8_t> data;
 
     size_t offset;
 
@@ -37,17 +56,37 @@ class SiglentDigitalReader
 
   void open(const std::string& filename);
 
+  // Reads from an already mapped capture, shared with other readers
+  void open(std::shared_ptr<const MappedFile> file);
+
+  // Fills out with up to out.size() samples, rounded down to whole octets, and returns how many
+  // were written. Nothing is allocated: buffers can be reused for the whole conversion.
+  size_t chunk(std::span<uint16_t> out);
+
   std::vector<uint16_t> chunk(size_t chunk_size);
 
+  // Skips count samples, a multiple of 8
+  void skip(size_t count);
+
+  size_t remaining() const { return (octets - octets_read) * 8; }
+
+  // Input the next count samples will be read from (one span per plane), without consuming them
+  std::vector<std::span<const uint8_t>> peek(size_t count) const;
+
   private:
 
-  std::vector<std::ifstream> fs;
+  std::shared_ptr<const MappedFile> f;
+
+  // One bit plane per active channel, each octets long
+  std::vector<std::span<const uint8_t>> planes;
 
   size_t octets_read;
 
   const size_t seek;
 
+  const size_t channels;
+
   const size_t octets;
 };
 
-#endif // SRZIP_HPP_
\ No newline at end of file
+#endif // SRZIP_HPP_
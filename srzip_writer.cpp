@@ -0,0 +1,348 @@
+#include "srzip_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "crc32.hpp"
+
+namespace {
+
+// Streamed members are read from their producer this many bytes at a time
+const size_t WRITER_BLOCK_BYTES = 1 << 20;
+
+const uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+const uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+const uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+
+// Offset of the CRC field in a local header, followed by compressed and uncompressed sizes
+const size_t LOCAL_HEADER_CRC_OFFSET = 14;
+
+// Values that do not fit their 32 bit field are set to all ones, the actual value goes to a ZIP64 record
+const uint64_t ZIP64_LIMIT = 0xffffffff;
+const size_t ZIP64_ENTRIES_LIMIT = 0xffff;
+
+const uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064b50;
+const uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+const uint16_t ZIP64_EXTRA_ID = 0x0001;
+
+// Version 2.0: deflate, version 4.5: ZIP64
+const uint16_t VERSION_NEEDED = 20;
+const uint16_t VERSION_NEEDED_ZIP64 = 45;
+// Made by: Unix, so that external attributes hold a file mode
+const uint16_t VERSION_MADE_BY = (3 << 8) | VERSION_NEEDED;
+
+// General purpose flags: names are UTF-8
+const uint16_t FLAG_UTF8 = 1 << 11;
+
+// Regular file, rw-r--r--
+const uint32_t EXTERNAL_ATTRIBUTES = 0100644u << 16;
+
+// ZIP records are little endian
+class RecordBuilder
+{
+  public:
+
+    RecordBuilder& u16(uint16_t v)
+    {
+      bytes.push_back(std::byte(v));
+      bytes.push_back(std::byte(v >> 8));
+      return *this;
+    }
+
+    RecordBuilder& u32(uint32_t v)
+    {
+      u16(v);
+      return u16(v >> 16);
+    }
+
+    RecordBuilder& u64(uint64_t v)
+    {
+      u32(v);
+      return u32(v >> 32);
+    }
+
+    RecordBuilder& str(const std::string& s)
+    {
+      auto b = std::as_bytes(std::span(s));
+      bytes.insert(bytes.end(), b.begin(), b.end());
+      return *this;
+    }
+
+    RecordBuilder& raw(std::span<const std::byte> b)
+    {
+      bytes.insert(bytes.end(), b.begin(), b.end());
+      return *this;
+    }
+
+    std::vector<std::byte> bytes;
+};
+
+uint32_t field32(uint64_t v)
+{
+  return std::min(v, ZIP64_LIMIT);
+}
+
+}
+
+SrzipWriter::SrzipWriter(const std::string& filename)
+  : filename(filename), offset(0)
+{
+  fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    throw std::runtime_error("Failed creating " + filename + ": " + std::strerror(errno));
+
+  time_t now = time(NULL);
+  struct tm t;
+  localtime_r(&now, &t);
+
+  // MS-DOS dates start in 1980, times have a 2 seconds resolution
+  dos_time = t.tm_hour << 11 | t.tm_min << 5 | t.tm_sec / 2;
+  dos_date = (std::max(t.tm_year - 80, 0)) << 9 | (t.tm_mon + 1) << 5 | t.tm_mday;
+}
+
+SrzipWriter::~SrzipWriter()
+{
+  if (fd >= 0)
+  {
+    ::close(fd);
+    ::unlink(filename.c_str());
+  }
+}
+
+void SrzipWriter::write(std::span<const std::byte> data)
+{
+  while (!data.empty())
+  {
+    ssize_t n = ::write(fd, data.data(), data.size());
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error(std::string("error writing archive: ") + std::strerror(errno));
+    }
+
+    data = data.subspan(n);
+    offset += n;
+  }
+}
+
+void SrzipWriter::write_local_header(const entry_t& entry)
+{
+  // Both sizes go to the extra field, even if only one of them is too large
+  RecordBuilder r;
+  r.u32(LOCAL_HEADER_SIGNATURE)
+   .u16(entry.zip64 ? VERSION_NEEDED_ZIP64 : VERSION_NEEDED)
+   .u16(FLAG_UTF8)
+   .u16(entry.method)
+   .u16(dos_time)
+   .u16(dos_date)
+   .u32(entry.crc)
+   .u32(entry.zip64 ? ZIP64_LIMIT : entry.compressed_size)
+   .u32(entry.zip64 ? ZIP64_LIMIT : entry.size)
+   .u16(entry.name.size())
+   .u16(entry.zip64 ? 20 : 0)
+   .str(entry.name);
+
+  if (entry.zip64)
+    r.u16(ZIP64_EXTRA_ID)
+     .u16(16)
+     .u64(entry.size)
+     .u64(entry.compressed_size);
+
+  write(r.bytes);
+}
+
+void SrzipWriter::add(const std::string& name, const compressed_member_t& member)
+{
+  if (fd < 0)
+    throw std::runtime_error("Archive already closed");
+
+  const bool zip64 = member.size >= ZIP64_LIMIT || member.data.size() >= ZIP64_LIMIT;
+
+  entry_t entry{ name, member.method, member.crc, member.size, member.data.size(), offset, zip64 };
+
+  write_local_header(entry);
+  write(member.data);
+
+  entries.push_back(std::move(entry));
+}
+
+static std::string sizeMismatch(const std::string& name, uint64_t produced, uint64_t announced)
+{
+  return "Member " + name + ": " + std::to_string(produced) + " bytes produced, " + std::to_string(announced) + " announced";
+}
+
+void SrzipWriter::add(const std::string& name, member_source_t source)
+{
+  if (fd < 0)
+    throw std::runtime_error("Archive already closed");
+
+  auto producer = source.open();
+  std::vector<std::byte> block(std::min(WRITER_BLOCK_BYTES, std::max<size_t>(source.size, 1)));
+
+  if (source.compression != compression_t::STORE)
+  {
+    MemberCompressor compressor;
+    compressor.begin(source.size, source.compression);
+
+    while (size_t n = producer(block))
+      compressor.update(std::span(block).first(n));
+
+    auto compressed = compressor.finish();
+    if (compressed.size != source.size)
+      throw std::runtime_error(sizeMismatch(name, compressed.size, source.size));
+
+    add(name, std::move(compressed));
+    return;
+  }
+
+  // Sizes and CRC are only known once the member is written: the announced size decides
+  // whether the local header has room for 64 bit sizes
+  entry_t entry{ name, ZIP_METHOD_STORE, 0, 0, 0, offset, source.size >= ZIP64_LIMIT };
+
+  write_local_header(entry);
+
+  while (size_t n = producer(block))
+  {
+    auto data = std::span(block).first(n);
+    entry.crc = crc32_update(entry.crc, data);
+    entry.size += n;
+    write(data);
+  }
+
+  entry.compressed_size = entry.size;
+
+  // The local header is already written: a member of another size cannot be fixed up
+  if (entry.size != source.size)
+    throw std::runtime_error(sizeMismatch(name, entry.size, source.size));
+
+  RecordBuilder r;
+  r.u32(entry.crc);
+  if (entry.zip64)
+    r.u32(ZIP64_LIMIT)
+     .u32(ZIP64_LIMIT)
+     .u16(entry.name.size())
+     .u16(20)
+     .str(entry.name)
+     .u16(ZIP64_EXTRA_ID)
+     .u16(16)
+     .u64(entry.size)
+     .u64(entry.compressed_size);
+  else
+    r.u32(entry.compressed_size)
+     .u32(entry.size);
+
+  if (pwrite(fd, r.bytes.data(), r.bytes.size(), entry.offset + LOCAL_HEADER_CRC_OFFSET) != ssize_t(r.bytes.size()))
+    throw std::runtime_error(std::string("error writing archive: ") + std::strerror(errno));
+
+  entries.push_back(std::move(entry));
+}
+
+void SrzipWriter::add(const std::string& name, std::span<const std::byte> data)
+{
+  MemberCompressor compressor;
+  compressor.begin(data.size());
+  compressor.update(data);
+
+  add(name, compressor.finish());
+}
+
+void SrzipWriter::close()
+{
+  if (fd < 0)
+    return;
+
+  const uint64_t directory_offset = offset;
+
+  RecordBuilder r;
+  for (const auto& entry : entries)
+  {
+    // Only the fields too large for the header go to the extra field, in this order
+    RecordBuilder extra;
+    if (entry.size >= ZIP64_LIMIT)
+      extra.u64(entry.size);
+    if (entry.compressed_size >= ZIP64_LIMIT)
+      extra.u64(entry.compressed_size);
+    if (entry.offset >= ZIP64_LIMIT)
+      extra.u64(entry.offset);
+
+    if (!extra.bytes.empty())
+    {
+      RecordBuilder header;
+      header.u16(ZIP64_EXTRA_ID).u16(extra.bytes.size());
+      extra.bytes.insert(extra.bytes.begin(), header.bytes.begin(), header.bytes.end());
+    }
+
+    const bool zip64 = entry.zip64 || !extra.bytes.empty();
+
+    r.u32(CENTRAL_HEADER_SIGNATURE)
+     .u16(VERSION_MADE_BY)
+     .u16(zip64 ? VERSION_NEEDED_ZIP64 : VERSION_NEEDED)
+     .u16(FLAG_UTF8)
+     .u16(entry.method)
+     .u16(dos_time)
+     .u16(dos_date)
+     .u32(entry.crc)
+     .u32(field32(entry.compressed_size))
+     .u32(field32(entry.size))
+     .u16(entry.name.size())
+     .u16(extra.bytes.size())
+     .u16(0)   // comment length
+     .u16(0)   // disk number
+     .u16(0)   // internal attributes
+     .u32(EXTERNAL_ATTRIBUTES)
+     .u32(field32(entry.offset))
+     .str(entry.name)
+     .raw(extra.bytes);
+  }
+
+  const uint64_t directory_size = r.bytes.size();
+
+  if (entries.size() >= ZIP64_ENTRIES_LIMIT || directory_size >= ZIP64_LIMIT || directory_offset >= ZIP64_LIMIT)
+  {
+    const uint64_t record_offset = directory_offset + directory_size;
+
+    r.u32(ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE)
+     .u64(44)  // size of the rest of the record
+     .u16((VERSION_MADE_BY & 0xff00) | VERSION_NEEDED_ZIP64)
+     .u16(VERSION_NEEDED_ZIP64)
+     .u32(0)   // disk number
+     .u32(0)   // disk with the central directory
+     .u64(entries.size())
+     .u64(entries.size())
+     .u64(directory_size)
+     .u64(directory_offset);
+
+    r.u32(ZIP64_LOCATOR_SIGNATURE)
+     .u32(0)   // disk with the ZIP64 end of central directory
+     .u64(record_offset)
+     .u32(1);  // number of disks
+  }
+
+  r.u32(END_OF_CENTRAL_DIRECTORY_SIGNATURE)
+   .u16(0)   // disk number
+   .u16(0)   // disk with the central directory
+   .u16(std::min(entries.size(), ZIP64_ENTRIES_LIMIT))
+   .u16(std::min(entries.size(), ZIP64_ENTRIES_LIMIT))
+   .u32(field32(directory_size))
+   .u32(field32(directory_offset))
+   .u16(0);  // comment length
+
+  write(r.bytes);
+
+  if (::close(fd) < 0)
+  {
+    fd = -1;
+    throw std::runtime_error(std::string("error writing archive: ") + std::strerror(errno));
+  }
+
+  fd = -1;
+  entries.clear();
+}
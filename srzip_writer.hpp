@@ -0,0 +1,81 @@
+#ifndef SRZIP_WRITER_HPP_
+#define SRZIP_WRITER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "member_stream.hpp"
+#include "compression.hpp"
+
+// Writes a new srzip archive front to back, in a single pass.
+// Each member is written as soon as it is added: local header, then data.
+// The central directory is written once, on close().
+// Nothing is ever read back, so output runs at disk bandwidth.
+// ZIP64 records are emitted where needed: members or archives above 4 GiB, more than 65534 members.
+class SrzipWriter
+{
+  public:
+
+    explicit SrzipWriter(const std::string& filename);
+
+    SrzipWriter(const SrzipWriter&) = delete;
+    SrzipWriter& operator=(const SrzipWriter&) = delete;
+
+    // An archive never closed is incomplete: the file is removed
+    ~SrzipWriter();
+
+    // Member compressed elsewhere, copied as is
+    void add(const std::string& name, const compressed_member_t& member);
+
+    // Member produced on demand.
+    // Stored members are streamed to disk, their CRC and sizes patched into the local header afterwards;
+    // other members are compressed first, then copied.
+    void add(const std::string& name, member_source_t source);
+
+    // Small member, deflated
+    void add(const std::string& name, std::span<const std::byte> data);
+
+    void add(const std::string& name, const std::string& data)
+    {
+      add(name, std::as_bytes(std::span(data)));
+    }
+
+    // Writes the central directory
+    void close();
+
+  private:
+
+    struct entry_t {
+      std::string name;
+      uint16_t method;
+      uint32_t crc;
+      uint64_t size;
+      uint64_t compressed_size;
+      // Of the local header
+      uint64_t offset;
+      // Local header has 64 bit sizes
+      bool zip64;
+    };
+
+    void write(std::span<const std::byte> data);
+
+    void write_local_header(const entry_t& entry);
+
+    const std::string filename;
+
+    int fd;
+
+    // Where the next write goes
+    uint64_t offset;
+
+    // MS-DOS date and time, the same for every member
+    uint16_t dos_time;
+    uint16_t dos_date;
+
+    std::vector<entry_t> entries;
+};
+
+#endif // SRZIP_WRITER_HPP_
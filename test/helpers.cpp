@@ -0,0 +1,76 @@
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#include "../siglent_bin.hpp"
+
+std::vector<std::byte> inflate_raw(const std::vector<std::byte>& data, size_t size)
+{
+  // One spare byte: zlib wants somewhere to write even for empty output, and overlong streams show up
+  std::vector<std::byte> out(size + 1);
+
+  z_stream z = {};
+  inflateInit2(&z, -MAX_WBITS);
+
+  z.next_in = (Bytef*)data.data();
+  z.avail_in = data.size();
+  z.next_out = (Bytef*)out.data();
+  z.avail_out = out.size();
+
+  int ret = inflate(&z, Z_FINISH);
+  inflateEnd(&z);
+
+  if (ret != Z_STREAM_END || z.total_out != size)
+    throw std::runtime_error("Corrupted deflate stream");
+
+  out.resize(size);
+  return out;
+}
+
+void writeSyntheticCapture(const std::string& filename, size_t analog_channels, uint32_t analog_size, uint32_t oversample)
+{
+  const uint32_t digital_size = analog_size * oversample;
+
+  std::vector<uint8_t> header(DATA_OFFSET);
+  auto put = [&header] (size_t offset, auto value) { std::memcpy(&header[offset], &value, sizeof(value)); };
+
+  for (size_t c = 0; c < MAX_ANALOG_CHANNELS; c++)
+  {
+    put(0x00 + 4 * c, uint32_t(c < analog_channels));
+    put(0x10 + 16 * c, 1.0);       // scale: 1 V
+    put(0x18 + 16 * c, uint32_t(magnitude_t::IU));
+    put(0x50 + 16 * c, 0.0);       // offset: 0 V
+    put(0x58 + 16 * c, uint32_t(magnitude_t::IU));
+  }
+  put(0x90, uint32_t(oversample > 0));
+  put(0x94, uint32_t(oversample > 0));
+  put(0xf4, analog_size);
+  put(0xf8, 1.0);
+  put(0x100, uint32_t(magnitude_t::GIGA));
+  put(0x108, digital_size);
+  put(0x10c, double(oversample));
+  put(0x114, uint32_t(magnitude_t::GIGA));
+
+  std::ofstream out(filename, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+  std::vector<char> samples(std::max(analog_size, digital_size / 8));
+  for (size_t i = 0; i < samples.size(); i++)
+    samples[i] = char(128 + (i >> 10) % 64);
+  for (size_t c = 0; c < analog_channels; c++)
+    out.write(samples.data(), analog_size);
+
+  out.write(samples.data(), digital_size / 8);
+}
+
+void setHeaderField(const std::string& filename, size_t offset, uint32_t value)
+{
+  std::fstream f(filename, std::ios::in | std::ios::out | std::ios::binary);
+  f.seekp(offset);
+  f.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
@@ -0,0 +1,19 @@
+#ifndef TEST_HELPERS_HPP_
+#define TEST_HELPERS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Inflates a raw deflate stream of known uncompressed size, throws if it is corrupted or of another size
+std::vector<std::byte> inflate_raw(const std::vector<std::byte>& data, size_t size);
+
+// Capture with analog_channels channels of analog_size samples (1 V/div, no offset), and one digital probe
+// oversampling them when oversample is not 0. Samples are slow ramps.
+void writeSyntheticCapture(const std::string& filename, size_t analog_channels, uint32_t analog_size, uint32_t oversample);
+
+// Overwrites the 32 bit header field at offset of a capture, such as 0x108 for digital_size
+void setHeaderField(const std::string& filename, size_t offset, uint32_t value);
+
+#endif // TEST_HELPERS_HPP_
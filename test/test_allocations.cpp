@@ -0,0 +1,77 @@
+#include "catch.hpp"
+
+#include "../siglent_bin.hpp"
+#include "../srzip.hpp"
+#include "../analog_convert.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Counts every heap allocation of the test binary, so that a steady-state
+// conversion loop can be shown to allocate nothing.
+static std::atomic<size_t> allocations = 0;
+
+void* operator new(size_t size)
+{
+  allocations++;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+// Out of line, or GCC mistakes the inlined free() for a mismatched deallocation
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  ::operator delete(p);
+}
+
+TEST_CASE("Digital conversion into caller buffers does not allocate", "[allocations]") {
+  SiglentDigitalReader reader(0, 5, 8);
+  reader.open("test-digital-5ch.bin");
+
+  std::vector<uint16_t> buffer(16);
+
+  size_t before = allocations;
+
+  size_t samples = 0;
+  while (size_t n = reader.chunk(std::span(buffer)))
+    samples += n;
+
+  size_t after = allocations;
+
+  REQUIRE(samples == 64);
+  REQUIRE(after == before);
+}
+
+TEST_CASE("Analog conversion into caller buffers does not allocate", "[allocations]") {
+  header_t header;
+  header.analog_scales[0] = { 1.0, magnitude_t::IU, unit_t::V };
+  header.analog_offsets[0] = { 0.0, magnitude_t::IU, unit_t::V };
+
+  SiglentAnalogReader reader(0, 40);
+  reader.open("test-digital-5ch.bin");
+
+  const AnalogLut lut(header, 0);
+  std::vector<float> buffer(16 * 2);
+
+  size_t before = allocations;
+
+  size_t samples = 0;
+  for (auto chunk = reader.chunk(16); chunk.size(); chunk = reader.chunk(16))
+  {
+    lut.convert(chunk, 2, std::span(buffer).first(chunk.size() * 2));
+    samples += chunk.size();
+  }
+
+  size_t after = allocations;
+
+  REQUIRE(samples == 40);
+  REQUIRE(after == before);
+}
@@ -0,0 +1,157 @@
+#include "catch.hpp"
+
+#include "../siglent_bin.hpp"
+#include "../analog_convert.hpp"
+#include "../member_stream.hpp"
+
+#include <string>
+#include <cstring>
+#include <vector>
+
+const size_t SAMPLES_PER_BENCHMARK = 1 << 20;
+
+static header_t analog_header()
+{
+  header_t header;
+
+  header.analog_scales[0] = { 0.2, magnitude_t::IU, unit_t::V };
+  header.analog_offsets[0] = { -0.5, magnitude_t::IU, unit_t::V };
+  header.analog_scales[1] = { 5.0, magnitude_t::IU, unit_t::V };
+  header.analog_offsets[1] = { 1.25, magnitude_t::IU, unit_t::V };
+
+  return header;
+}
+
+// Conversion as originally done sample by sample in double precision
+static float reference(const header_t& header, size_t channel, uint8_t sample)
+{
+  double ret = double(int(sample)-128) * header.analog_scales[channel].get_value() * 10.7 / 256;
+  ret -= header.analog_offsets[channel].get_value();
+  return (float)ret;
+}
+
+TEST_CASE("Analog calibration reproduces the code to volt formula", "[analog-convert]") {
+  header_t header = analog_header();
+
+  for (size_t channel : { 0, 1 })
+  {
+    auto cal = getAnalogCalibration(header, channel);
+
+    for (int code = 0; code < 256; code++)
+      REQUIRE(code * cal.gain + cal.bias == Approx(reference(header, channel, code)).margin(1e-5));
+  }
+}
+
+TEST_CASE("Vectorized analog conversion matches the scalar reference", "[analog-convert]") {
+  header_t header = analog_header();
+  auto cal = getAnalogCalibration(header, 1);
+
+  // Odd length to exercise the vector tail
+  std::vector<uint8_t> codes(1000 + 13);
+  for (size_t i = 0; i < codes.size(); i++)
+    codes[i] = i * 37;
+
+  for (size_t oversample : { 1, 2, 5 })
+  {
+    std::vector<float> expected(codes.size() * oversample);
+    std::vector<float> actual(codes.size() * oversample);
+
+    convert_analog_scalar(codes, cal, oversample, expected);
+    convert_analog(codes, cal, oversample, actual);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < expected.size(); i++)
+      mismatches += actual[i] != Approx(expected[i]).margin(1e-5);
+
+    REQUIRE(mismatches == 0);
+
+    // Every code is replicated oversample times in a row
+    for (size_t i = 0; i < codes.size(); i++)
+      for (size_t k = 1; k < oversample; k++)
+        mismatches += actual[i * oversample + k] != actual[i * oversample];
+
+    REQUIRE(mismatches == 0);
+  }
+}
+
+TEST_CASE("Analog lookup table is bit exact with the original conversion", "[analog-convert]") {
+  header_t header = analog_header();
+
+  for (size_t channel : { 0, 1 })
+  {
+    AnalogLut lut(header, channel);
+
+    size_t mismatches = 0;
+    for (int code = 0; code < 256; code++)
+      mismatches += lut[code] != reference(header, channel, code);
+
+    REQUIRE(mismatches == 0);
+
+    std::vector<uint8_t> codes = { 0, 1, 127, 128, 129, 255 };
+    std::vector<float> out(codes.size() * 3);
+
+    lut.convert(codes, 3, out);
+
+    for (size_t i = 0; i < out.size(); i++)
+      mismatches += out[i] != reference(header, channel, codes[i / 3]);
+
+    REQUIRE(mismatches == 0);
+  }
+}
+
+TEST_CASE("Analog conversion: lookup table against arithmetic kernel", "[analog-convert][!benchmark]") {
+  header_t header = analog_header();
+  auto cal = getAnalogCalibration(header, 0);
+  AnalogLut lut(header, 0);
+
+  std::vector<uint8_t> codes(SAMPLES_PER_BENCHMARK);
+  for (size_t i = 0; i < codes.size(); i++)
+    codes[i] = i * 37;
+
+  for (size_t oversample : { 1, 4 })
+  {
+    std::vector<float> out(codes.size() * oversample);
+
+    BENCHMARK("scalar, oversample " + std::to_string(oversample)) {
+      convert_analog_scalar(codes, cal, oversample, out);
+      return out[0];
+    };
+
+    BENCHMARK("SIMD arithmetic, oversample " + std::to_string(oversample)) {
+      convert_analog(codes, cal, oversample, out);
+      return out[0];
+    };
+
+    BENCHMARK("lookup table, oversample " + std::to_string(oversample)) {
+      lut.convert(codes, oversample, out);
+      return out[0];
+    };
+  }
+}
+
+TEST_CASE("Analog member streamed in arbitrary reads matches direct conversion", "[analog-convert]") {
+  header_t header = analog_header();
+  AnalogLut lut(header, 1);
+
+  SiglentAnalogReader reader(0, 40);
+  reader.open("test-digital-5ch.bin");
+
+  auto codes = SiglentAnalogReader(reader).chunk(40);
+  std::vector<float> expected(40 * 3);
+  lut.convert(codes, 3, expected);
+
+  reader.skip(10);
+  auto member = analogMember(reader, 100, lut, 3);
+
+  REQUIRE(member.size == 30 * 3 * sizeof(float));
+
+  auto producer = member.open();
+
+  std::vector<std::byte> data;
+  std::byte buffer[5];
+  while (size_t n = producer(buffer))
+    data.insert(data.end(), buffer, buffer + n);
+
+  REQUIRE(data.size() == member.size);
+  REQUIRE(std::memcmp(data.data(), expected.data() + 10 * 3, data.size()) == 0);
+}
@@ -0,0 +1,76 @@
+#include "catch.hpp"
+
+#include "../batch.hpp"
+#include "../siglent_bin.hpp"
+#include "helpers.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+TEST_CASE("Batch inputs expand folders and patterns", "[batch]") {
+  const fs::path dir = "test-batch-inputs";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "nested");
+
+  for (auto name : { "SDS00002.bin", "SDS00001.BIN", "notes.txt", "nested/SDS00003.bin" })
+    std::ofstream(dir / name) << "x";
+
+  // Folders: their own .bin files, sorted
+  auto inputs = expandInputs({ dir.string() });
+  REQUIRE(inputs == std::vector<fs::path>{ dir / "SDS00001.BIN", dir / "SDS00002.bin" });
+
+  // Patterns left to the program, files as they are, each capture once
+  inputs = expandInputs({ (dir / "nested" / "*.bin").string(), (dir / "SDS00002.bin").string(), dir.string() });
+  REQUIRE(inputs == std::vector<fs::path>{ dir / "nested" / "SDS00003.bin", dir / "SDS00002.bin", dir / "SDS00001.BIN" });
+
+  REQUIRE_THROWS(expandInputs({ (dir / "missing.bin").string() }));
+  REQUIRE_THROWS(expandInputs({ (dir / "*.dat").string() }));
+
+  REQUIRE(outputPath(dir / "SDS00002.bin", "") == dir / "SDS00002.srzip");
+  REQUIRE(outputPath(dir / "SDS00002.bin", "out") == fs::path("out") / "SDS00002.srzip");
+
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Batch converts every capture and reports failures", "[batch]") {
+  const fs::path dir = "test-batch-convert";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "out");
+  fs::create_directories(dir / "again");
+
+  writeSyntheticCapture((dir / "small.bin").string(), 1, 1000, 0);
+  writeSyntheticCapture((dir / "large.bin").string(), 2, 100000, 4);
+  writeSyntheticCapture((dir / "logic.bin").string(), 0, 5000, 8);
+
+  // Header announcing samples it does not have
+  writeSyntheticCapture((dir / "truncated.bin").string(), 2, 1000, 0);
+  fs::resize_file(dir / "truncated.bin", DATA_OFFSET + 1500);
+
+  // Same output name as the first small.bin
+  fs::copy_file(dir / "small.bin", dir / "again" / "small.bin");
+
+  batch_options_t options;
+  options.conversion.jobs = 3;
+  options.output_dir = dir / "out";
+  options.parallel_files = 2;
+
+  auto inputs = expandInputs({ dir.string(), (dir / "again").string() });
+  REQUIRE(inputs.size() == 5);
+
+  const auto summary = convertBatch(inputs, options);
+
+  REQUIRE(summary.converted == 3);
+  REQUIRE(summary.failed == 2);
+  REQUIRE(summary.input_bytes == fs::file_size(dir / "small.bin") + fs::file_size(dir / "large.bin") + fs::file_size(dir / "logic.bin"));
+  REQUIRE(summary.output_bytes > 0);
+
+  for (auto name : { "small.srzip", "large.srzip", "logic.srzip" })
+    REQUIRE(fs::exists(dir / "out" / name));
+
+  // Failed conversions leave no partial archive behind
+  REQUIRE_FALSE(fs::exists(dir / "out" / "truncated.srzip"));
+
+  fs::remove_all(dir);
+}
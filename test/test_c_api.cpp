@@ -0,0 +1,227 @@
+#include "catch.hpp"
+
+#include "../siglent_bin2sr.h"
+#include "../siglent_bin.hpp"
+#include "../analog_convert.hpp"
+#include "../mapped_file.hpp"
+#include "helpers.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+TEST_CASE("C interface parses headers", "[c-api]") {
+  REQUIRE(sb2sr_api_version() == SB2SR_API_VERSION);
+
+  sb2sr_header header;
+  REQUIRE(sb2sr_parse_header_file("SDS00001.bin", &header) == SB2SR_OK);
+
+  const header_t expected = parse_siglent_header_file("SDS00001.bin");
+  for (size_t c = 0; c < SB2SR_ANALOG_CHANNELS; c++)
+  {
+    REQUIRE(header.analog_on[c] == expected.analog_ch_on[c]);
+    REQUIRE(header.analog_scale[c] == expected.analog_scales[c].value);
+  }
+  REQUIRE(header.digital_on == expected.digital_on);
+  REQUIRE(header.analog_size == expected.analog_size);
+  REQUIRE(header.digital_sample_rate == expected.digital_sample_rate.value);
+
+  REQUIRE(sb2sr_parse_header_file(nullptr, &header) == SB2SR_INVALID_ARGUMENT);
+  REQUIRE(std::strlen(sb2sr_last_error()) > 0);
+}
+
+TEST_CASE("C interface reads samples into caller buffers", "[c-api]") {
+  const std::string filename = "test-c-api.bin";
+  const uint32_t analog_size = 5000;
+  writeSyntheticCapture(filename, 2, analog_size, 4);
+
+  sb2sr_capture* capture = nullptr;
+  REQUIRE(sb2sr_capture_open(filename.c_str(), &capture) == SB2SR_OK);
+
+  sb2sr_header header;
+  REQUIRE(sb2sr_capture_header(capture, &header) == SB2SR_OK);
+  REQUIRE(header.analog_size == analog_size);
+  REQUIRE(header.digital_size == analog_size * 4);
+
+  // Channel 3 is off
+  sb2sr_analog_reader* analog = nullptr;
+  REQUIRE(sb2sr_analog_reader_open(capture, 2, &analog) == SB2SR_INVALID_ARGUMENT);
+  REQUIRE(analog == nullptr);
+
+  REQUIRE(sb2sr_analog_reader_open(capture, 1, &analog) == SB2SR_OK);
+
+  sb2sr_logic_reader* logic = nullptr;
+  REQUIRE(sb2sr_logic_reader_open(capture, &logic) == SB2SR_OK);
+
+  // Readers keep the capture mapped
+  sb2sr_capture_close(capture);
+
+  const header_t h = parse_siglent_header_file(filename);
+  const AnalogLut lut(h, 1);
+  MappedFile file(filename);
+
+  // Second channel, after a skip and through reads smaller than the channel
+  REQUIRE(sb2sr_analog_skip(analog, 100) == SB2SR_OK);
+  std::vector<float> volts(1024);
+  size_t position = 100;
+  while (int64_t n = sb2sr_analog_read(analog, volts.data(), volts.size()))
+  {
+    REQUIRE(n > 0);
+    for (int64_t i = 0; i < n; i++)
+      REQUIRE(volts[i] == lut[file.data()[DATA_OFFSET + analog_size + position + i]]);
+    position += n;
+  }
+  REQUIRE(position == analog_size);
+  REQUIRE(sb2sr_analog_remaining(analog) == 0);
+  sb2sr_analog_reader_close(analog);
+
+  // One probe, after both channels: bit 0 of each sample is the plane bit, LSB first
+  REQUIRE(sb2sr_logic_skip(logic, 3) == SB2SR_INVALID_ARGUMENT);
+  REQUIRE(sb2sr_logic_read(logic, nullptr, 8) == SB2SR_INVALID_ARGUMENT);
+
+  std::vector<uint16_t> samples(1001);
+  position = 0;
+  while (int64_t n = sb2sr_logic_read(logic, samples.data(), samples.size()))
+  {
+    REQUIRE(n == std::min<int64_t>(1000, header.digital_size - position));
+    for (int64_t i = 0; i < n; i++)
+    {
+      const uint8_t octet = file.data()[DATA_OFFSET + 2 * analog_size + (position + i) / 8];
+      REQUIRE(samples[i] == ((octet >> ((position + i) % 8)) & 1));
+    }
+    position += n;
+  }
+  REQUIRE(position == header.digital_size);
+  sb2sr_logic_reader_close(logic);
+
+  std::filesystem::remove(filename);
+}
+
+namespace {
+
+struct countdown_t {
+  uint64_t left;
+};
+
+// Bytes counting down, served in reads of at most 100 bytes
+int64_t countdown(void* user, void* buffer, size_t size)
+{
+  auto& c = *static_cast<countdown_t*>(user);
+  const size_t n = std::min<uint64_t>({ size, c.left, 100 });
+  for (size_t i = 0; i < n; i++)
+    static_cast<uint8_t*>(buffer)[i] = uint8_t(--c.left);
+  return n;
+}
+
+int64_t failing(void*, void*, size_t)
+{
+  return -1;
+}
+
+void count_messages(void* user, sb2sr_log_level level, const char* message)
+{
+  if (level == SB2SR_LOG_INFO && std::strlen(message) > 0)
+    ++*static_cast<size_t*>(user);
+}
+
+}
+
+TEST_CASE("C interface writes archives", "[c-api]") {
+  const std::string filename = "test-c-api.srzip";
+  const std::string version = "2";
+
+  sb2sr_writer* writer = nullptr;
+  REQUIRE(sb2sr_writer_open(filename.c_str(), &writer) == SB2SR_OK);
+
+  REQUIRE(sb2sr_writer_add(writer, "version", version.data(), version.size(), SB2SR_STORE) == SB2SR_OK);
+
+  countdown_t source{ 1000 };
+  REQUIRE(sb2sr_writer_add_stream(writer, "logic-1-1", 1000, countdown, &source, SB2SR_STORE) == SB2SR_OK);
+  REQUIRE(source.left == 0);
+
+  source.left = 10;
+  REQUIRE(sb2sr_writer_add_stream(writer, "logic-1-2", 1000, countdown, &source, SB2SR_DEFAULT) == SB2SR_ERROR);
+  REQUIRE(sb2sr_writer_add_stream(writer, "logic-1-3", 10, failing, nullptr, SB2SR_DEFAULT) == SB2SR_ERROR);
+  REQUIRE(std::string(sb2sr_last_error()) == "Member source failed");
+
+  REQUIRE(sb2sr_writer_close(writer) == SB2SR_OK);
+
+  // Stored members are copied verbatim after their local header
+  MappedFile file(filename);
+  auto data = file.data();
+  REQUIRE(std::memcmp(data.data() + 30 + 7, version.data(), version.size()) == 0);
+
+  const size_t logic = 30 + 7 + version.size() + 30 + 9;
+  for (size_t i = 0; i < 1000; i++)
+    REQUIRE(data[logic + i] == uint8_t(999 - i));
+
+  file.close();
+  std::filesystem::remove(filename);
+
+  // Discarded archives are removed
+  REQUIRE(sb2sr_writer_open(filename.c_str(), &writer) == SB2SR_OK);
+  sb2sr_writer_discard(writer);
+  REQUIRE_FALSE(std::filesystem::exists(filename));
+}
+
+TEST_CASE("C interface converts captures", "[c-api]") {
+  const std::string capture = "test-c-api-convert.bin";
+  writeSyntheticCapture(capture, 1, 100000, 2);
+
+  sb2sr_options options;
+  sb2sr_default_options(&options);
+  REQUIRE(options.analog_compression == SB2SR_DEFAULT);
+  REQUIRE(options.logic_compression == SB2SR_DEFAULT);
+
+  // Zero-initialized options are the defaults
+  const sb2sr_options zero = {};
+  REQUIRE(zero.analog_compression == SB2SR_DEFAULT);
+  REQUIRE(zero.logic_compression == SB2SR_DEFAULT);
+  options.jobs = 2;
+  options.chunk_samples = 0x10000;
+
+  // Library messages go to the callback while it is set
+  size_t messages = 0;
+  sb2sr_set_log_callback(count_messages, &messages);
+  REQUIRE(sb2sr_convert(capture.c_str(), "test-c-api-once.srzip", &options) == SB2SR_OK);
+  sb2sr_set_log_callback(nullptr, nullptr);
+  REQUIRE(messages > 0);
+
+  sb2sr_converter* converter = nullptr;
+  REQUIRE(sb2sr_converter_create(&options, &converter) == SB2SR_OK);
+  for (auto out : { "test-c-api-warm-1.srzip", "test-c-api-warm-2.srzip" })
+  {
+    REQUIRE(sb2sr_converter_run(converter, capture.c_str(), out) == SB2SR_OK);
+    REQUIRE(std::filesystem::file_size(out) == std::filesystem::file_size("test-c-api-once.srzip"));
+  }
+
+  REQUIRE(sb2sr_converter_run(converter, "missing.bin", "test-c-api-missing.srzip") == SB2SR_ERROR);
+  REQUIRE_FALSE(std::filesystem::exists("test-c-api-missing.srzip"));
+  sb2sr_converter_destroy(converter);
+
+  for (auto f : { "test-c-api-once.srzip", "test-c-api-warm-1.srzip", "test-c-api-warm-2.srzip" })
+    std::filesystem::remove(f);
+  std::filesystem::remove(capture);
+}
+
+TEST_CASE("C interface reports captures with fewer logic than analog samples", "[c-api]") {
+  const std::string capture = "test-c-api-malformed.bin";
+
+  sb2sr_options options;
+  sb2sr_default_options(&options);
+  options.jobs = 1;
+
+  // Digital size below the analog one, or none at all with probes on: no oversampling factor
+  for (uint32_t digital_size : { 16u, 0u })
+  {
+    writeSyntheticCapture(capture, 1, 1000, 2);
+    setHeaderField(capture, 0x108, digital_size);
+
+    REQUIRE(sb2sr_convert(capture.c_str(), "test-c-api-malformed.srzip", &options) == SB2SR_ERROR);
+    REQUIRE(std::string(sb2sr_last_error()).find("smaller than analog size") != std::string::npos);
+    REQUIRE_FALSE(std::filesystem::exists("test-c-api-malformed.srzip"));
+  }
+
+  std::filesystem::remove(capture);
+}
@@ -0,0 +1,138 @@
+#include "catch.hpp"
+
+#include "../capture_index.hpp"
+#include "helpers.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+TEST_CASE("Capture index is updated incrementally", "[index]") {
+  const fs::path dir = "test-index";
+  const fs::path filename = dir / "captures.idx";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+
+  // Analog only at 1 Sa/s, and two channels with one probe at 4 Sa/s
+  writeSyntheticCapture((dir / "analog.bin").string(), 1, 1000, 0);
+  writeSyntheticCapture((dir / "mixed.bin").string(), 2, 1000, 4);
+
+  const std::string analog = fs::absolute(dir / "analog.bin").lexically_normal().string();
+  const std::string mixed = fs::absolute(dir / "mixed.bin").lexically_normal().string();
+
+  {
+    CaptureIndex index(filename);
+    REQUIRE(index.size() == 0);
+
+    auto stats = index.update({ dir / "mixed.bin", dir / "analog.bin" }, 2);
+    REQUIRE(stats.scanned == 2);
+    REQUIRE(stats.unchanged == 0);
+    REQUIRE(index.size() == 2);
+
+    const index_record_t* record = index.find(mixed);
+    REQUIRE(record);
+    REQUIRE(index.path(*record) == mixed);
+    REQUIRE(record->analog_on == 0b11);
+    REQUIRE(record->digital_ch_on == 0b1);
+    REQUIRE(record->digital_size == 4000);
+    REQUIRE(record->sample_rate == 4.0);
+    REQUIRE(index.notes(*record).empty());
+    REQUIRE_FALSE(index.find("test-index/mixed.bin"));
+
+    // Relative paths name the same entries
+    stats = index.update({ "test-index/../test-index/mixed.bin" }, 2);
+    REQUIRE(stats.scanned == 0);
+    REQUIRE(stats.unchanged == 2);
+  }
+
+  // Queries read the index file in place
+  {
+    const CaptureIndex index(filename);
+    REQUIRE(index.size() == 2);
+
+    auto paths = [&index] (const index_query_t& q) {
+      std::vector<std::string> out;
+      for (const auto* record : index.query(q))
+        out.emplace_back(index.path(*record));
+      return out;
+    };
+
+    REQUIRE(paths({}) == std::vector<std::string>{ analog, mixed });
+
+    index_query_t q;
+    q.min_sample_rate = 2;
+    REQUIRE(paths(q) == std::vector<std::string>{ mixed });
+
+    q = {};
+    q.max_sample_rate = 1;
+    REQUIRE(paths(q) == std::vector<std::string>{ analog });
+
+    q = {};
+    q.analog_channels = 0b10;
+    REQUIRE(paths(q) == std::vector<std::string>{ mixed });
+
+    q = {};
+    q.digital = true;
+    REQUIRE(paths(q) == std::vector<std::string>{ mixed });
+
+    const capture_info_t info = index.info(*index.find(mixed));
+    REQUIRE(formatInfoJson(info) == formatInfoJson(readCaptureInfo(mixed)));
+  }
+
+  // Changed captures are read again, removed ones forgotten
+  writeSyntheticCapture((dir / "analog.bin").string(), 3, 2000, 0);
+  fs::remove(dir / "mixed.bin");
+  {
+    CaptureIndex index(filename);
+    const auto stats = index.update({}, 2);
+    REQUIRE(stats.scanned == 1);
+    REQUIRE(stats.removed == 1);
+    REQUIRE(index.size() == 1);
+    REQUIRE(index.find(analog)->analog_on == 0b111);
+    REQUIRE(index.find(analog)->analog_size == 2000);
+  }
+
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Capture index rejects foreign files and rebuilds old versions", "[index]") {
+  const fs::path dir = "test-index-version";
+  const fs::path filename = dir / "captures.idx";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+
+  writeSyntheticCapture((dir / "capture.bin").string(), 1, 1000, 0);
+  CaptureIndex(filename).update({ dir / "capture.bin" }, 1);
+
+  // Version follows the magic
+  {
+    std::fstream f(filename, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(8);
+    const uint32_t old_version = INDEX_VERSION + 1;
+    f.write(reinterpret_cast<const char*>(&old_version), sizeof(old_version));
+  }
+
+  {
+    CaptureIndex index(filename);
+    REQUIRE(index.size() == 0);
+
+    // Refreshed without inputs, it would be replaced by an empty index
+    REQUIRE_THROWS_WITH(index.update({}, 1), Catch::Contains("re-run with the capture folders"));
+    REQUIRE(fs::file_size(filename) > sizeof(index_file_header_t));
+
+    REQUIRE(index.update({ dir / "capture.bin" }, 1).scanned == 1);
+  }
+  REQUIRE(CaptureIndex(filename).size() == 1);
+
+  // Truncated
+  fs::resize_file(filename, fs::file_size(filename) - 1);
+  REQUIRE_THROWS(CaptureIndex(filename));
+
+  std::ofstream(filename) << "not an index at all, but long enough to hold a header";
+  REQUIRE_THROWS(CaptureIndex(filename));
+
+  fs::remove_all(dir);
+}
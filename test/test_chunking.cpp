@@ -0,0 +1,148 @@
+#include "catch.hpp"
+
+#include "../chunking.hpp"
+
+TEST_CASE("Chunk size aims at the target member size", "[chunking]") {
+  chunk_constraints_t c;
+  c.samples = 1 << 30;
+  c.streams = 4;
+  c.bytes_per_sample = sizeof(float);
+  c.granularity = 8;
+  c.workers = 4;
+  c.queue_depth = 8;
+  c.memory = size_t(16) << 30;
+
+  REQUIRE(chooseChunkSamples(c) == TARGET_MEMBER_BYTES / sizeof(float));
+
+  // Logic only: twice as many 16 bit samples for the same member size
+  c.bytes_per_sample = sizeof(uint16_t);
+  REQUIRE(chooseChunkSamples(c) == TARGET_MEMBER_BYTES / sizeof(uint16_t));
+}
+
+TEST_CASE("Chunk size splits small captures between workers", "[chunking]") {
+  chunk_constraints_t c;
+  c.samples = 0x400000;
+  c.streams = 2;
+  c.bytes_per_sample = sizeof(float);
+  c.granularity = 8;
+  c.workers = 8;
+  c.queue_depth = 8;
+  c.memory = size_t(16) << 30;
+
+  const size_t chunk = chooseChunkSamples(c);
+  const size_t members = c.streams * ((c.samples + chunk - 1) / chunk);
+
+  REQUIRE(chunk < TARGET_MEMBER_BYTES / sizeof(float));
+  REQUIRE(members >= c.workers * MEMBERS_PER_WORKER);
+
+  // Never below the floor, even with many workers
+  c.workers = 1024;
+  REQUIRE(chooseChunkSamples(c) == MIN_CHUNK_SAMPLES);
+
+  // Nor above the capture
+  c.samples = 1000;
+  REQUIRE(chooseChunkSamples(c) == 1000);
+}
+
+TEST_CASE("Chunk size shrinks to fit memory", "[chunking]") {
+  chunk_constraints_t c;
+  c.samples = 1 << 30;
+  c.streams = 4;
+  c.bytes_per_sample = sizeof(float);
+  c.granularity = 24;
+  c.workers = 4;
+  c.queue_depth = 4;
+  c.memory = 16 << 20;
+
+  const size_t chunk = chooseChunkSamples(c);
+
+  REQUIRE(chunk % 24 == 0);
+  REQUIRE(chunk * sizeof(float) * c.queue_depth <= c.memory);
+  REQUIRE(chunk > c.memory / sizeof(float) / c.queue_depth - 24);
+
+  // Capture pages of the members in flight count too
+  c.input_bytes_per_sample = 1;
+  REQUIRE(chooseChunkSamples(c) * (sizeof(float) + 1) * c.queue_depth <= c.memory);
+}
+
+TEST_CASE("Memory budget shortens the queue, then shrinks chunks", "[chunking]") {
+  chunk_constraints_t c;
+  c.samples = 1 << 30;
+  c.streams = 4;
+  c.bytes_per_sample = sizeof(float);
+  c.input_bytes_per_sample = 1;
+  c.granularity = 8;
+  c.workers = 2;
+  c.queue_depth = 8;
+  c.memory = size_t(16) << 30;
+
+  const size_t reserved = BASE_MEMORY_BYTES + c.workers * WORKER_MEMORY_BYTES;
+
+  // Plenty: nothing changes
+  auto plan = fitMemoryBudget(c, size_t(4) << 30);
+  REQUIRE(plan.queue_depth == 8);
+  REQUIRE(plan.chunk_samples == chooseChunkSamples(c));
+  REQUIRE(plan.peak_bytes <= size_t(4) << 30);
+
+  // Tight: fewer members in flight, still a quarter of the target size at least
+  const size_t budget = reserved + (16 << 20);
+  plan = fitMemoryBudget(c, budget);
+  REQUIRE(plan.queue_depth < 8);
+  REQUIRE(plan.chunk_samples * sizeof(float) >= TARGET_MEMBER_BYTES / 4);
+  REQUIRE(plan.peak_bytes <= budget);
+
+  // Tighter: a single member in flight, smaller chunks
+  plan = fitMemoryBudget(c, reserved + (2 << 20));
+  REQUIRE(plan.queue_depth == 1);
+  REQUIRE(plan.chunk_samples * sizeof(float) < TARGET_MEMBER_BYTES / 4);
+  REQUIRE(plan.peak_bytes <= reserved + (2 << 20));
+
+  // Too small for anything: smallest settings, reported over budget
+  plan = fitMemoryBudget(c, 1 << 20);
+  REQUIRE(plan.queue_depth == 1);
+  REQUIRE(plan.chunk_samples == MIN_CHUNK_SAMPLES);
+  REQUIRE(plan.peak_bytes > (1 << 20));
+
+  // Requested chunks are kept, only the queue gives way
+  plan = fitMemoryBudget(c, reserved + (16 << 20), 0x100000);
+  REQUIRE(plan.chunk_samples == 0x100000);
+  REQUIRE(plan.queue_depth == 16 / 5);
+
+  // Reserve already set aside by the caller: the whole budget goes to members
+  REQUIRE(reservedMemory(c.workers) == reserved);
+  plan = fitMemoryBudget(c, 16 << 20, 0, 0);
+  REQUIRE(plan.queue_depth == fitMemoryBudget(c, budget).queue_depth);
+  REQUIRE(plan.chunk_samples == fitMemoryBudget(c, budget).chunk_samples);
+  REQUIRE(plan.peak_bytes <= (16 << 20));
+}
+
+TEST_CASE("Memory sizes are parsed with binary suffixes", "[chunking]") {
+  REQUIRE(parse_memory_size("4096") == 4096);
+  REQUIRE(parse_memory_size("64K") == 64 << 10);
+  REQUIRE(parse_memory_size("512M") == size_t(512) << 20);
+  REQUIRE(parse_memory_size("2G") == size_t(2) << 30);
+  REQUIRE(parse_memory_size("1.5GiB") == size_t(3) << 29);
+  REQUIRE(parse_memory_size("100MB") == size_t(100) << 20);
+
+  REQUIRE_THROWS(parse_memory_size(""));
+  REQUIRE_THROWS(parse_memory_size("M"));
+  REQUIRE_THROWS(parse_memory_size("-1G"));
+  REQUIRE_THROWS(parse_memory_size("12X"));
+  REQUIRE_THROWS(parse_memory_size("0.5"));
+  REQUIRE_THROWS(parse_memory_size("1e-4K"));
+  REQUIRE_THROWS(parse_memory_size("1e30"));
+  REQUIRE_THROWS(parse_memory_size("1e10T"));
+  REQUIRE_THROWS(parse_memory_size("inf"));
+
+  REQUIRE(peakResidentMemory() > 0);
+}
+
+TEST_CASE("Requested chunk sizes are aligned", "[chunking]") {
+  REQUIRE(alignChunkSamples(1000, 8) == 1000);
+  REQUIRE(alignChunkSamples(1001, 8) == 1000);
+  REQUIRE(alignChunkSamples(3, 8) == 8);
+  REQUIRE(alignChunkSamples(100, 24) == 96);
+  REQUIRE(alignChunkSamples(100, 0) == 100);
+
+  REQUIRE(availableMemory() > 0);
+}
@@ -0,0 +1,121 @@
+#include "catch.hpp"
+
+#include "../compression.hpp"
+#include "helpers.hpp"
+
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+TEST_CASE("Member compressor round trip", "[compression]") {
+  // Mildly compressible data, larger than the initial output buffer
+  std::vector<std::byte> input(300000);
+  uint32_t seed = 1;
+  for (auto& b : input)
+  {
+    seed = seed * 1103515245 + 12345;
+    b = std::byte((seed >> 16) & 0x0f);
+  }
+
+  MemberCompressor compressor;
+
+  // Used twice, to make sure it resets between members
+  for (int round = 0; round < 2; round++)
+  {
+    compressor.begin(input.size());
+
+    // Uneven pieces
+    for (size_t offset = 0, piece = 1; offset < input.size(); offset += piece, piece = piece * 3 + 1)
+      compressor.update(std::span(input).subspan(offset, std::min(piece, input.size() - offset)));
+
+    auto member = compressor.finish();
+
+    REQUIRE(member.method == ZIP_METHOD_DEFLATE);
+    REQUIRE(member.size == input.size());
+    REQUIRE(member.crc == crc32(0, (const Bytef*)input.data(), input.size()));
+    REQUIRE(member.data.size() < input.size());
+    REQUIRE(inflate_raw(member.data, member.size) == input);
+  }
+}
+
+TEST_CASE("Empty member compresses to a valid stream", "[compression]") {
+  MemberCompressor compressor;
+  compressor.begin(0);
+  auto member = compressor.finish();
+
+  REQUIRE(member.size == 0);
+  REQUIRE(member.crc == 0);
+  REQUIRE(inflate_raw(member.data, 0).empty());
+}
+
+TEST_CASE("Stored members are kept verbatim", "[compression]") {
+  std::vector<std::byte> input(1000);
+  for (size_t i = 0; i < input.size(); i++)
+    input[i] = std::byte(i * 7);
+
+  MemberCompressor compressor;
+  compressor.begin(input.size(), compression_t::STORE);
+  compressor.update(std::span(input).first(300));
+  compressor.update(std::span(input).subspan(300));
+  auto member = compressor.finish();
+
+  REQUIRE(member.method == ZIP_METHOD_STORE);
+  REQUIRE(member.crc == crc32(0, (const Bytef*)input.data(), input.size()));
+  REQUIRE(member.data == input);
+
+  // And the compressor still deflates afterwards
+  compressor.begin(input.size(), compression_t::BEST);
+  compressor.update(input);
+  member = compressor.finish();
+
+  REQUIRE(member.method == ZIP_METHOD_DEFLATE);
+  REQUIRE(inflate_raw(member.data, member.size) == input);
+}
+
+TEST_CASE("Compression names", "[compression]") {
+  for (auto c : { compression_t::STORE, compression_t::FAST, compression_t::DEFAULT, compression_t::BEST })
+    REQUIRE(parse_compression(to_string(c)) == c);
+
+  REQUIRE_THROWS(parse_compression("zstd"));
+}
+
+TEST_CASE("Compression ratio against throughput", "[compression][!benchmark]") {
+  const size_t samples = 1 << 20;
+
+  // Analog: 8 bit noisy sine converted to float volts, as written in analog-* members
+  std::vector<float> analog(samples);
+  uint32_t seed = 1;
+  for (size_t i = 0; i < samples; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    int code = 128 + int(100 * std::sin(i * 0.001)) + int((seed >> 16) % 5) - 2;
+    analog[i] = (code - 128) * 0.2f * 10.7f / 256;
+  }
+
+  // Logic: 8 channels, square waves of different periods, as written in logic-* members
+  std::vector<uint16_t> logic(samples);
+  for (size_t i = 0; i < samples; i++)
+    for (size_t c = 0; c < 8; c++)
+      logic[i] |= ((i >> (c + 3)) & 1) << c;
+
+  for (auto [kind, data] : { std::pair("analog", std::as_bytes(std::span(analog))), std::pair("logic", std::as_bytes(std::span(logic))) })
+  {
+    for (auto c : { compression_t::STORE, compression_t::FAST, compression_t::DEFAULT, compression_t::BEST })
+    {
+      MemberCompressor compressor;
+      size_t compressed = 0;
+
+      BENCHMARK(std::string(kind) + " " + to_string(c)) {
+        compressor.begin(data.size(), c);
+        compressor.update(data);
+        compressed = compressor.finish().data.size();
+        return compressed;
+      };
+
+      WARN(kind << " " << to_string(c) << ": ratio " << double(data.size()) / compressed);
+    }
+  }
+}
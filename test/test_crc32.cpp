@@ -0,0 +1,90 @@
+#include "catch.hpp"
+
+#include "../crc32.hpp"
+
+#include <vector>
+
+#include <zlib.h>
+
+static std::vector<std::byte> pseudoRandom(size_t size)
+{
+  std::vector<std::byte> data(size);
+  uint32_t seed = 7;
+  for (auto& b : data)
+  {
+    seed = seed * 1103515245 + 12345;
+    b = std::byte(seed >> 16);
+  }
+  return data;
+}
+
+static uint32_t zlibCrc(std::span<const std::byte> data)
+{
+  return crc32_z(0, reinterpret_cast<const Bytef*>(data.data()), data.size());
+}
+
+TEST_CASE("CRC32 matches zlib", "[crc32]") {
+  const auto data = pseudoRandom(4096 + 77);
+
+  REQUIRE(crc32_update(0, {}) == 0);
+  REQUIRE(crc32_update(0, std::as_bytes(std::span("123456789", 9))) == 0xcbf43926);
+
+  // Every length around the folding block sizes, at unaligned starts
+  size_t mismatches = 0;
+  for (size_t offset = 0; offset < 4; offset++)
+    for (size_t len = 0; len < 300; len++)
+    {
+      auto piece = std::span(data).subspan(offset, len);
+      uint32_t expected = zlibCrc(piece);
+      if (crc32_update(0, piece) != expected || crc32_update_portable(0, piece) != expected)
+        mismatches++;
+    }
+  REQUIRE(mismatches == 0);
+
+  REQUIRE(crc32_update(0, data) == zlibCrc(data));
+}
+
+TEST_CASE("CRC32 incremental update", "[crc32]") {
+  const auto data = pseudoRandom(10000);
+  const std::span<const std::byte> all(data);
+
+  uint32_t crc = 0;
+  for (size_t pos = 0, step = 1; pos < data.size(); pos += step, step = step * 3 + 1)
+    crc = crc32_update(crc, all.subspan(pos, std::min(step, data.size() - pos)));
+
+  REQUIRE(crc == zlibCrc(all));
+}
+
+TEST_CASE("CRC32 combine", "[crc32]") {
+  const auto data = pseudoRandom(5000);
+  const std::span<const std::byte> all(data);
+
+  for (size_t split : { size_t(0), size_t(1), size_t(63), size_t(64), size_t(2500), size_t(4999), size_t(5000) })
+  {
+    auto a = all.first(split);
+    auto b = all.subspan(split);
+
+    uint32_t combined = crc32_combine(crc32_update(0, a), crc32_update(0, b), b.size());
+    REQUIRE(combined == zlibCrc(all));
+    REQUIRE(combined == crc32_combine64(zlibCrc(a), zlibCrc(b), b.size()));
+  }
+
+  // Lengths beyond 32 bits, checked against zlib
+  REQUIRE(crc32_combine(0x12345678, 0x9abcdef0, 0x123456789ull) == crc32_combine64(0x12345678, 0x9abcdef0, 0x123456789ull));
+}
+
+TEST_CASE("CRC32 throughput", "[crc32][!benchmark]") {
+  const auto data = pseudoRandom(1 << 24);
+
+  BENCHMARK("zlib") {
+    return zlibCrc(data);
+  };
+
+  BENCHMARK("portable") {
+    return crc32_update_portable(0, data);
+  };
+
+  BENCHMARK("dispatched") {
+    return crc32_update(0, data);
+  };
+}
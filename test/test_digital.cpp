@@ -1,8 +1,12 @@
 #include "catch.hpp"
 
 #include "../srzip.hpp"
+#include "../digital_transpose.hpp"
+#include "../member_stream.hpp"
 #include "../utils/stream.hpp"
 
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 
 #include <iostream>
@@ -53,4 +57,99 @@ TEST_CASE("Srzip digital conversion from oscilloscope-like bin", "[srzip-digital
   REQUIRE(chunk[2] == 0x02);
   REQUIRE(chunk[3] == 0x03);
   REQUIRE(chunk[7] == 0x07);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Srzip digital conversion spanning several transposition blocks", "[srzip-digital]" ) {
+  const size_t channels = 3;
+  const size_t octets = DIGITAL_BLOCK_OCTETS * 2 + 5;
+
+  // Plane of channel c holds octet i as (i * (c + 1)) & 0xff
+  {
+    std::ofstream out("test-digital-blocks.bin", std::ios::binary);
+    for (size_t c = 0; c < channels; c++)
+      for (size_t i = 0; i < octets; i++)
+        out.put((char)(i * (c + 1)));
+  }
+
+  SiglentDigitalReader reader(0, channels, octets);
+
+  reader.open("test-digital-blocks.bin");
+
+  // Odd chunk size, so that chunks do not line up with blocks
+  size_t sample = 0;
+  size_t mismatches = 0;
+  for (auto chunk = reader.chunk(8 * 3001); chunk.size(); chunk = reader.chunk(8 * 3001))
+  {
+    for (auto value : chunk)
+    {
+      uint16_t expected = 0;
+      for (size_t c = 0; c < channels; c++)
+        expected |= ((((sample / 8) * (c + 1)) >> (sample % 8)) & 0x01) << c;
+
+      mismatches += value != expected;
+      sample++;
+    }
+  }
+
+  REQUIRE(mismatches == 0);
+  REQUIRE(sample == octets * 8);
+
+  std::filesystem::remove("test-digital-blocks.bin");
+}
+
+TEST_CASE("Vectorized plane transposition matches the scalar reference", "[srzip-digital]" ) {
+  // Enough octets for several vector iterations plus a scalar tail
+  const size_t octets = 16 * 5 + 7;
+
+  std::vector<std::vector<uint8_t>> data(16, std::vector<uint8_t>(octets));
+  uint32_t seed = 12345;
+  for (auto& plane : data)
+    for (auto& octet : plane)
+    {
+      seed = seed * 1103515245 + 12345;
+      octet = seed >> 16;
+    }
+
+  for (size_t channels : { 1, 5, 8, 9, 16 })
+  {
+    std::vector<const uint8_t*> planes;
+    for (size_t c = 0; c < channels; c++)
+      planes.push_back(data[c].data());
+
+    // Garbage in the output must be overwritten
+    std::vector<uint16_t> expected(octets * 8, 0xaaaa);
+    std::vector<uint16_t> actual(octets * 8, 0x5555);
+
+    transpose_planes_scalar(planes, octets, expected);
+    transpose_planes(planes, octets, actual);
+
+    REQUIRE(actual == expected);
+  }
+}
+
+TEST_CASE("Logic member streamed in arbitrary reads matches chunked conversion", "[srzip-digital]" ) {
+  SiglentDigitalReader reader(0, 5, 8);
+  reader.open("test-digital-5ch.bin");
+
+  auto expected = SiglentDigitalReader(reader).chunk(64);
+
+  reader.skip(16);
+  auto member = logicMember(reader, 100);
+
+  // Clamped to the 48 samples left in the capture
+  REQUIRE(member.size == 48 * sizeof(uint16_t));
+
+  auto producer = member.open();
+
+  // Odd read size: samples straddle reads
+  std::vector<std::byte> data;
+  std::byte buffer[7];
+  while (size_t n = producer(buffer))
+    data.insert(data.end(), buffer, buffer + n);
+
+  REQUIRE(data.size() == member.size);
+  REQUIRE(std::memcmp(data.data(), expected.data() + 16, data.size()) == 0);
+
+  // The reader handed to the member did not move
+  REQUIRE(reader.remaining() == 48);
+}
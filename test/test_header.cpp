@@ -3,7 +3,11 @@
 #include "../siglent_bin.hpp"
 #include "../utils/stream.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <string>
+#include <vector>
 
 TEST_CASE("Oscilloscope header deserializer Test", "[bin-deserializer]" ) {
   std::ifstream f("SDS00001.bin");
@@ -37,4 +41,54 @@ TEST_CASE("Oscilloscope header deserializer Test", "[bin-deserializer]" ) {
 
   REQUIRE(header.analog_sample_rate.value == 1000000000.0);
   REQUIRE(header.analog_sample_rate.magnitude == magnitude_t::IU);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Header decodes from a buffer or a mapping", "[bin-deserializer]" ) {
+  std::ifstream f("SDS00001.bin");
+  const header_t from_stream = parse(f);
+
+  MappedFile file("SDS00001.bin");
+  const header_t from_mapping = parse(file);
+
+  // The test capture stops one byte short of the header end: the missing byte reads as zero
+  REQUIRE(file.size() < HEADER_SIZE);
+  REQUIRE(std::memcmp(&from_stream.analog_scales, &from_mapping.analog_scales, sizeof(from_stream.analog_scales)) == 0);
+  REQUIRE(from_mapping.analog_sample_rate.value == from_stream.analog_sample_rate.value);
+  REQUIRE(uint32_t(from_mapping.digital_sample_rate.unit) == 0x0035ac38);
+
+  const header_t from_file = parse_siglent_header_file("SDS00001.bin");
+  REQUIRE(from_file.analog_ch_on == from_mapping.analog_ch_on);
+  REQUIRE(from_file.digital_ch_on == from_mapping.digital_ch_on);
+  REQUIRE(from_file.digital_sample_rate.value == from_mapping.digital_sample_rate.value);
+
+  // Nothing at all: every field is zero
+  const header_t empty = parse(std::span<const uint8_t>());
+  REQUIRE_FALSE(empty.analog_ch_on[0]);
+  REQUIRE(empty.analog_size == 0);
+  REQUIRE(empty.time_div.value == 0.0);
+
+  REQUIRE_THROWS(parse_siglent_header_file("missing.bin"));
+}
+
+TEST_CASE("Header validation and dump follow the layout table", "[bin-deserializer]" ) {
+  MappedFile file("SDS00001.bin");
+
+  // Only the missing last byte stands out
+  REQUIRE(validate_header(file.data()) == std::vector<std::string>{ "header truncated: 283 of 284 bytes" });
+
+  std::vector<uint8_t> bytes(file.data().begin(), file.data().end());
+  bytes.resize(HEADER_SIZE);
+  REQUIRE(validate_header(bytes).empty());
+
+  bytes[0x08] = 2;            // chx_on[2]
+  bytes[0x18 + 16 * 3] = 20;  // analog_scales[3] magnitude
+  REQUIRE(validate_header(bytes) == std::vector<std::string>{
+    "chx_on[2]: 2 is not 0 or 1",
+    "analog_scales[3]: unknown magnitude 20" });
+
+  const std::string dump = dump_header(file.data());
+  REQUIRE(dump.find("0x000 chx_on[0] = 1\n") != std::string::npos);
+  REQUIRE(dump.find("0x040 analog_scales[3] = 0.2 (magnitude 8, unit 0)\n") != std::string::npos);
+  REQUIRE(dump.find("0x0f4 analog_size = 0\n") != std::string::npos);
+  REQUIRE(std::count(dump.begin(), dump.end(), '\n') == 4 + 4 + 4 + 1 + 16 + 1 + 1 + 1 + 1 + 1 + 1);
+}
@@ -0,0 +1,43 @@
+#include "catch.hpp"
+
+#include "../info.hpp"
+#include "helpers.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+TEST_CASE("Info scan reads headers only", "[info]") {
+  writeSyntheticCapture("test-info.bin", 2, 1000, 4);
+
+  const auto infos = scanCaptures({ "test-info.bin", "SDS00001.bin", "missing.bin" }, 4);
+  REQUIRE(infos.size() == 3);
+
+  // In input order, whichever finished first
+  REQUIRE(infos[0].path == "test-info.bin");
+  REQUIRE(infos[0].error.empty());
+  REQUIRE(infos[0].problems.empty());
+  REQUIRE(infos[0].size == DATA_OFFSET + 2 * 1000 + 4000 / 8);
+  REQUIRE(infos[0].header.digital_size == 4000);
+  REQUIRE(captureDuration(infos[0].header) == Approx(1000));
+
+  REQUIRE(infos[1].problems == std::vector<std::string>{ "header truncated: 283 of 284 bytes" });
+  REQUIRE_FALSE(infos[2].error.empty());
+
+  REQUIRE(formatInfoJson(infos[0]) ==
+    "{\"path\":\"test-info.bin\",\"size\":4548,"
+    "\"analog_channels\":[1,2],\"analog_sample_rate\":1,\"analog_size\":1000,"
+    "\"digital_channels\":[1],\"digital_sample_rate\":4,\"digital_size\":4000,"
+    "\"time_div\":0,\"time_delay\":0,\"duration\":1000,\"problems\":[]}");
+  REQUIRE(formatInfoJson(infos[2]).starts_with("{\"path\":\"missing.bin\",\"error\":\"Failed opening"));
+
+  const std::string table = formatInfoTable(infos);
+  REQUIRE(table.starts_with("FILE "));
+  REQUIRE(table.find("test-info.bin  ") != std::string::npos);
+  REQUIRE(table.find("1,2  ") != std::string::npos);
+  REQUIRE(table.find("4 Sa/s") != std::string::npos);
+  REQUIRE(table.find("error: Failed opening missing.bin") != std::string::npos);
+  REQUIRE(std::count(table.begin(), table.end(), '\n') == 4);
+
+  std::filesystem::remove("test-info.bin");
+}
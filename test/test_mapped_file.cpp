@@ -0,0 +1,66 @@
+#include "catch.hpp"
+
+#include "../mapped_file.hpp"
+#include "../srzip.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+TEST_CASE("Mapped file exposes the same bytes as a stream read", "[mapped-file]") {
+  MappedFile f("SDS00001.bin");
+
+  std::ifstream s("SDS00001.bin", std::ios::binary);
+  std::vector<uint8_t> expected((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+
+  REQUIRE(f.is_open());
+  REQUIRE(f.size() == expected.size());
+  REQUIRE(std::equal(f.data().begin(), f.data().end(), expected.begin()));
+
+  SECTION("region inside the file")
+  {
+    auto r = f.region(0x10, 8);
+    REQUIRE(r.size() == 8);
+    REQUIRE(r.data() == f.data().data() + 0x10);
+  }
+
+  SECTION("region past the end of file")
+  {
+    REQUIRE_THROWS(f.region(f.size() - 1, 2));
+    REQUIRE_THROWS(f.region(f.size() + 1, 0));
+  }
+}
+
+TEST_CASE("Missing file cannot be mapped", "[mapped-file]") {
+  MappedFile f;
+  REQUIRE_THROWS(f.open("does-not-exist.bin"));
+  REQUIRE(f.is_open() == false);
+}
+
+TEST_CASE("Analog reader returns spans over the mapped capture", "[srzip-analog]") {
+  // 5 * 8 bytes of test data, read as a 40 samples analog channel
+  SiglentAnalogReader reader(0, 40);
+
+  reader.open("test-digital-5ch.bin");
+
+  std::ifstream s("test-digital-5ch.bin", std::ios::binary);
+  std::vector<uint8_t> expected((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+
+  auto first = reader.chunk(32);
+  auto second = reader.chunk(32);
+
+  REQUIRE(first.size() == 32);
+  REQUIRE(second.size() == 8);
+  REQUIRE(reader.chunk(32).size() == 0);
+
+  REQUIRE(std::equal(first.begin(), first.end(), expected.begin()));
+  REQUIRE(std::equal(second.begin(), second.end(), expected.begin() + 32));
+}
+
+TEST_CASE("Readers reject captures shorter than the header declares", "[srzip-analog]") {
+  SiglentAnalogReader analog(0, 41);
+  REQUIRE_THROWS(analog.open("test-digital-5ch.bin"));
+
+  SiglentDigitalReader digital(0, 6, 8);
+  REQUIRE_THROWS(digital.open("test-digital-5ch.bin"));
+}
@@ -0,0 +1,103 @@
+#include "catch.hpp"
+
+#include "../siglent_bin.hpp"
+#include "../srzip.hpp"
+#include "../analog_convert.hpp"
+#include "../member_stream.hpp"
+#include "../pipeline.hpp"
+#include "helpers.hpp"
+
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+// Reads a whole member through its producer, with reads of read_size bytes
+static std::vector<std::byte> drain(const member_source_t& member, size_t read_size)
+{
+  std::vector<std::byte> data;
+  std::vector<std::byte> buffer(read_size);
+
+  auto producer = member.open();
+  while (data.size() < member.size)
+  {
+    size_t n = producer(buffer);
+    if (n == 0)
+      break;
+    data.insert(data.end(), buffer.begin(), buffer.begin() + n);
+  }
+
+  return data;
+}
+
+TEST_CASE("Pipeline delivers every member in order and intact", "[pipeline]") {
+  header_t header;
+  header.analog_scales[0] = { 1.0, magnitude_t::IU, unit_t::V };
+  header.analog_offsets[0] = { 0.0, magnitude_t::IU, unit_t::V };
+  const AnalogLut lut(header, 0);
+
+  auto file = std::make_shared<const MappedFile>("test-digital-5ch.bin");
+
+  // Analog members of a few samples each, followed by logic members
+  std::vector<member_source_t> members;
+
+  SiglentAnalogReader analog(0, 40);
+  analog.open(file);
+  while (analog.remaining())
+  {
+    members.push_back(analogMember(analog, 3, lut, 2));
+    analog.skip(3);
+  }
+
+  SiglentDigitalReader digital(0, 5, 8);
+  digital.open(file);
+  while (digital.remaining())
+  {
+    members.push_back(logicMember(digital, 16));
+    digital.skip(16);
+  }
+
+  std::vector<std::vector<std::byte>> expected;
+  for (const auto& member : members)
+    expected.push_back(drain(member, 64));
+
+  // Depth 1 stresses block recycling: more members than blocks.
+  // Several workers convert members out of order, they must still come out in order.
+  for (auto [jobs, depth] : { std::pair(1, 1), std::pair(1, 4), std::pair(4, 1), std::pair(3, 16) })
+  {
+    ThreadPool pool(jobs);
+    ConversionPipeline pipeline(members, pool, depth);
+    pipeline.start();
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < members.size(); i++)
+    {
+      auto output = pipeline.take(i);
+      REQUIRE(output->size == members[i].size);
+      REQUIRE(output->method == ZIP_METHOD_DEFLATE);
+      mismatches += output->crc != crc32(0, (const Bytef*)expected[i].data(), expected[i].size());
+      mismatches += inflate_raw(output->data, output->size) != expected[i];
+    }
+
+    pipeline.finish();
+
+    REQUIRE(mismatches == 0);
+  }
+}
+
+TEST_CASE("Pipeline reports conversion failures", "[pipeline]") {
+  member_source_t broken = {
+    16,
+    [] () -> MemberProducer { throw std::runtime_error("conversion failed"); },
+    {}
+  };
+
+  ThreadPool pool(2);
+  ConversionPipeline pipeline({ broken }, pool, 2);
+  pipeline.start();
+
+  REQUIRE_THROWS(pipeline.take(0));
+  REQUIRE_THROWS_WITH(pipeline.finish(), "conversion failed");
+}
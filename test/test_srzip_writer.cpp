@@ -0,0 +1,427 @@
+#include "catch.hpp"
+
+#include "../srzip_writer.hpp"
+#include "../crc32.hpp"
+#include "../mapped_file.hpp"
+#include "../conversion.hpp"
+#include "../siglent_bin.hpp"
+#include "helpers.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+uint64_t le(std::span<const uint8_t> b, uint64_t offset, size_t bytes)
+{
+  if (offset + bytes > b.size())
+    throw std::runtime_error("Record out of the archive");
+
+  uint64_t v = 0;
+  for (size_t i = 0; i < bytes; i++)
+    v |= uint64_t(b[offset + i]) << (8 * i);
+  return v;
+}
+
+struct archive_entry_t {
+  uint16_t method;
+  uint32_t crc;
+  uint64_t size;
+  uint64_t offset;
+  // Compressed data
+  std::span<const uint8_t> data;
+};
+
+struct archive_t {
+  MappedFile file;
+  bool zip64 = false;
+  std::vector<std::string> names;
+  std::map<std::string, archive_entry_t> entries;
+};
+
+// Reads an archive through its central directory, checking local headers against it.
+// ZIP64 values replace the 32 bit fields set to all ones.
+void readArchive(const std::string& filename, archive_t& archive)
+{
+  archive.file.open(filename);
+  auto b = archive.file.data();
+
+  // No archive comment: the end of central directory record closes the file
+  const uint64_t end = b.size() - 22;
+  REQUIRE(le(b, end, 4) == 0x06054b50);
+
+  uint64_t entries = le(b, end + 10, 2);
+  uint64_t directory_size = le(b, end + 12, 4);
+  uint64_t p = le(b, end + 16, 4);
+
+  if (end >= 20 && le(b, end - 20, 4) == 0x07064b50)
+  {
+    const uint64_t record = le(b, end - 20 + 8, 8);
+    REQUIRE(le(b, record, 4) == 0x06064b50);
+    REQUIRE(record + 56 + 20 == end);
+
+    archive.zip64 = true;
+    entries = le(b, record + 32, 8);
+    directory_size = le(b, record + 40, 8);
+    p = le(b, record + 48, 8);
+  }
+
+  const uint64_t directory_end = p + directory_size;
+
+  for (size_t i = 0; i < entries; i++)
+  {
+    REQUIRE(le(b, p, 4) == 0x02014b50);
+
+    archive_entry_t entry;
+    entry.method = le(b, p + 10, 2);
+    entry.crc = le(b, p + 16, 4);
+    uint64_t compressed = le(b, p + 20, 4);
+    entry.size = le(b, p + 24, 4);
+    const size_t name_len = le(b, p + 28, 2);
+    const size_t extra_len = le(b, p + 30, 2);
+    entry.offset = le(b, p + 42, 4);
+    const std::string name(reinterpret_cast<const char*>(&b[p + 46]), name_len);
+
+    uint64_t extra = p + 46 + name_len;
+    if (extra_len > 0)
+    {
+      REQUIRE(le(b, extra, 2) == 0x0001);
+      extra += 4;
+      for (uint64_t* field : { &entry.size, &compressed, &entry.offset })
+        if (*field == 0xffffffff)
+        {
+          *field = le(b, extra, 8);
+          extra += 8;
+        }
+    }
+
+    // Local header agrees with the central directory
+    const uint64_t local = entry.offset;
+    const size_t local_name_len = le(b, local + 26, 2);
+    const size_t local_extra_len = le(b, local + 28, 2);
+    REQUIRE(le(b, local, 4) == 0x04034b50);
+    REQUIRE(le(b, local + 8, 2) == entry.method);
+    REQUIRE(le(b, local + 14, 4) == entry.crc);
+    if (local_extra_len > 0)
+    {
+      REQUIRE(le(b, local + 18, 4) == 0xffffffff);
+      REQUIRE(le(b, local + 22, 4) == 0xffffffff);
+      REQUIRE(le(b, local + 30 + local_name_len, 2) == 0x0001);
+      REQUIRE(le(b, local + 30 + local_name_len + 4, 8) == entry.size);
+      REQUIRE(le(b, local + 30 + local_name_len + 12, 8) == compressed);
+    }
+    else
+    {
+      REQUIRE(le(b, local + 18, 4) == compressed);
+      REQUIRE(le(b, local + 22, 4) == entry.size);
+    }
+    REQUIRE(local_name_len == name_len);
+
+    entry.data = b.subspan(local + 30 + local_name_len + local_extra_len, compressed);
+
+    archive.names.push_back(name);
+    archive.entries[name] = entry;
+    p += 46 + name_len + extra_len + le(b, p + 32, 2);
+  }
+
+  REQUIRE(p == directory_end);
+}
+
+// Uncompressed content of a member, checked against its CRC
+std::vector<std::byte> content(const archive_entry_t& entry)
+{
+  auto data = std::as_bytes(entry.data);
+  std::vector<std::byte> out(data.begin(), data.end());
+
+  if (entry.method == ZIP_METHOD_DEFLATE)
+    out = inflate_raw(out, entry.size);
+  else
+    REQUIRE(entry.method == ZIP_METHOD_STORE);
+
+  REQUIRE(out.size() == entry.size);
+  REQUIRE(crc32_update(0, out) == entry.crc);
+
+  return out;
+}
+
+std::vector<std::byte> pattern(size_t size, unsigned step)
+{
+  std::vector<std::byte> data(size);
+  for (size_t i = 0; i < size; i++)
+    data[i] = std::byte((i * step) >> 4);
+  return data;
+}
+
+// Serves data in reads of at most 1000 bytes
+member_source_t streamed(const std::vector<std::byte>& data, compression_t compression)
+{
+  member_source_t source;
+  source.size = data.size();
+  source.compression = compression;
+  source.open = [&data] {
+    return [&data, pos = size_t(0)] (std::span<std::byte> out) mutable {
+      size_t n = std::min({ out.size(), data.size() - pos, size_t(1000) });
+      std::memcpy(out.data(), data.data() + pos, n);
+      pos += n;
+      return n;
+    };
+  };
+  return source;
+}
+
+// size bytes of (position / 4096) & 0xff, without holding them in memory
+member_source_t generated(uint64_t size)
+{
+  member_source_t source;
+  source.size = size;
+  source.compression = compression_t::STORE;
+  source.open = [size] {
+    return [size, pos = uint64_t(0)] (std::span<std::byte> out) mutable {
+      size_t n = std::min<uint64_t>(out.size(), size - pos);
+      for (size_t i = 0; i < n; i++)
+        out[i] = std::byte((pos + i) >> 12);
+      pos += n;
+      return n;
+    };
+  };
+  return source;
+}
+
+}
+
+TEST_CASE("Srzip writer produces a readable archive", "[srzip-writer]") {
+  const std::string filename = "test-writer.srzip";
+
+  const auto deflated = pattern(100000, 3);
+  const auto stored = pattern(70000, 7);
+  const auto stream_stored = pattern(12345, 5);
+  const auto stream_deflated = pattern(54321, 11);
+  const std::vector<std::byte> nothing;
+
+  {
+    SrzipWriter writer(filename);
+
+    MemberCompressor compressor;
+    compressor.begin(deflated.size());
+    compressor.update(deflated);
+    writer.add("logic-1-1", compressor.finish());
+
+    compressor.begin(stored.size(), compression_t::STORE);
+    compressor.update(stored);
+    writer.add("logic-1-2", compressor.finish());
+
+    writer.add("analog-1-1-1", streamed(stream_stored, compression_t::STORE));
+    writer.add("analog-1-1-2", streamed(stream_deflated, compression_t::FAST));
+    writer.add("empty", streamed(nothing, compression_t::STORE));
+
+    writer.add("metadata", std::string("[global]\nsigrok version=0.5.2\n"));
+    writer.add("version", std::string("2"));
+
+    writer.close();
+  }
+
+  archive_t archive;
+  readArchive(filename, archive);
+
+  REQUIRE_FALSE(archive.zip64);
+  REQUIRE(archive.names == std::vector<std::string>{ "logic-1-1", "logic-1-2", "analog-1-1-1", "analog-1-1-2", "empty", "metadata", "version" });
+  REQUIRE(content(archive.entries["logic-1-1"]) == deflated);
+  REQUIRE(content(archive.entries["logic-1-2"]) == stored);
+  REQUIRE(content(archive.entries["analog-1-1-1"]) == stream_stored);
+  REQUIRE(content(archive.entries["analog-1-1-2"]) == stream_deflated);
+  REQUIRE(content(archive.entries["empty"]).empty());
+
+  const auto version = content(archive.entries["version"]);
+  REQUIRE(std::string(reinterpret_cast<const char*>(version.data()), version.size()) == "2");
+
+  archive.file.close();
+  std::filesystem::remove(filename);
+}
+
+// Members named prefix-1, prefix-2, ... concatenated in archive order
+static std::vector<std::byte> concatenated(archive_t& archive, const std::string& prefix)
+{
+  std::vector<std::byte> out;
+  for (size_t i = 1; archive.entries.count(prefix + std::to_string(i)); i++)
+  {
+    const auto data = content(archive.entries[prefix + std::to_string(i)]);
+    out.insert(out.end(), data.begin(), data.end());
+  }
+  return out;
+}
+
+TEST_CASE("Time window converts the samples around the trigger only", "[srzip-writer]") {
+  const std::string capture = "test-window-capture.bin";
+
+  // 4 logic samples per analog sample, time_div and time_delay 0: sample i of the logic timebase is at i / 4 s
+  writeSyntheticCapture(capture, 1, 4096, 4);
+
+  conversion_options_t options;
+  options.analog_compression = compression_t::STORE;
+  options.logic_compression = compression_t::STORE;
+  options.chunk_samples = 1024;
+  convertCapture(capture, "test-window-full.srzip", options);
+
+  // Samples 1003 to 9010: neither on an octet of logic samples, nor on replicas of an analog one
+  options.from = 1003 / 4.0;
+  options.to = 9010 / 4.0;
+  convertCapture(capture, "test-window.srzip", options);
+
+  archive_t full, window;
+  readArchive("test-window-full.srzip", full);
+  readArchive("test-window.srzip", window);
+
+  REQUIRE(window.names.size() == 2 * 8 + 2);
+  REQUIRE(window.entries["logic-1-1"].size == 1024 * sizeof(uint16_t));
+  REQUIRE(window.entries["logic-1-8"].size == (8008 - 7 * 1024) * sizeof(uint16_t));
+
+  const auto full_logic = concatenated(full, "logic-1-");
+  const auto full_analog = concatenated(full, "analog-1-2-");
+  REQUIRE(full_logic.size() == 4096 * 4 * sizeof(uint16_t));
+  REQUIRE(full_analog.size() == 4096 * 4 * sizeof(float));
+
+  const auto logic = concatenated(window, "logic-1-");
+  const auto analog = concatenated(window, "analog-1-2-");
+  REQUIRE(logic == std::vector<std::byte>(full_logic.begin() + 1003 * sizeof(uint16_t), full_logic.begin() + 9011 * sizeof(uint16_t)));
+  REQUIRE(analog == std::vector<std::byte>(full_analog.begin() + 1003 * sizeof(float), full_analog.begin() + 9011 * sizeof(float)));
+
+  // A window out of the capture converts nothing
+  options.from = 5000;
+  options.to = 6000;
+  REQUIRE_THROWS(convertCapture(capture, "test-window-empty.srzip", options));
+  REQUIRE_FALSE(std::filesystem::exists("test-window-empty.srzip"));
+
+  full.file.close();
+  window.file.close();
+  for (auto f : { "test-window-full.srzip", "test-window.srzip" })
+    std::filesystem::remove(f);
+  std::filesystem::remove(capture);
+}
+
+TEST_CASE("Srzip writer removes archives never closed", "[srzip-writer]") {
+  const std::string filename = "test-writer-discarded.srzip";
+
+  {
+    SrzipWriter writer(filename);
+    writer.add("version", std::string("2"));
+  }
+
+  REQUIRE_FALSE(std::filesystem::exists(filename));
+}
+
+TEST_CASE("Srzip writer rejects members of another size than announced", "[srzip-writer]") {
+  const std::string filename = "test-writer-sizes.srzip";
+  const auto data = pattern(5000, 3);
+
+  for (auto compression : { compression_t::STORE, compression_t::DEFAULT })
+    for (size_t announced : { data.size() + 1, data.size() - 1 })
+    {
+      SrzipWriter writer(filename);
+
+      auto source = streamed(data, compression);
+      source.size = announced;
+      REQUIRE_THROWS_WITH(writer.add("logic-1-1", source), Catch::Contains("5000 bytes produced"));
+    }
+
+  REQUIRE_FALSE(std::filesystem::exists(filename));
+}
+
+TEST_CASE("Srzip writer switches to ZIP64 above 65534 members", "[srzip-writer]") {
+  const std::string filename = "test-writer-entries.srzip";
+  const size_t members = 70000;
+
+  {
+    SrzipWriter writer(filename);
+    for (size_t i = 0; i < members; i++)
+      writer.add("logic-1-" + std::to_string(i + 1), generated(i % 3));
+    writer.close();
+  }
+
+  archive_t archive;
+  readArchive(filename, archive);
+
+  REQUIRE(archive.zip64);
+  REQUIRE(archive.names.size() == members);
+  REQUIRE(archive.names.back() == "logic-1-70000");
+  REQUIRE(content(archive.entries["logic-1-69999"]).size() == 69998 % 3);
+
+  archive.file.close();
+  std::filesystem::remove(filename);
+}
+
+// Writes over 4 GiB: hidden, run with [zip64-large]
+TEST_CASE("Srzip writer handles members and archives above 4 GiB", "[.][zip64-large]") {
+  const std::string filename = "test-writer-large.srzip";
+  const uint64_t large = (uint64_t(1) << 32) + 12345;
+
+  {
+    SrzipWriter writer(filename);
+    writer.add("version", std::string("2"));
+    writer.add("logic-1-1", generated(large));
+    writer.add("logic-1-2", generated(100000));
+    writer.close();
+  }
+
+  archive_t archive;
+  readArchive(filename, archive);
+
+  REQUIRE(archive.zip64);
+  REQUIRE(archive.names.size() == 3);
+
+  const auto& big = archive.entries["logic-1-1"];
+  REQUIRE(big.size == large);
+  REQUIRE(crc32_update(0, std::as_bytes(big.data)) == big.crc);
+
+  const auto& after = archive.entries["logic-1-2"];
+  REQUIRE(after.offset > large);
+  REQUIRE(content(after).size() == 100000);
+
+  archive.file.close();
+  std::filesystem::remove(filename);
+}
+
+// Converts a synthetic capture into more than 4 GiB of stored members: hidden, run with [zip64-large]
+TEST_CASE("Capture converted into an archive above 4 GiB", "[.][zip64-large]") {
+  const std::string capture = "test-large-capture.bin";
+  const std::string filename = "test-large-capture.srzip";
+
+  // 4 analog channels of 64 Mi samples, one digital probe oversampling them 4 times:
+  // 4 x 256 Mi float samples plus 256 Mi logic samples once converted
+  const uint32_t analog_size = 1 << 26;
+  const uint32_t digital_size = analog_size * 4;
+
+  writeSyntheticCapture(capture, MAX_ANALOG_CHANNELS, analog_size, 4);
+
+  conversion_options_t options;
+  options.analog_compression = compression_t::STORE;
+  options.logic_compression = compression_t::STORE;
+  convertCapture(capture, filename, options);
+
+  archive_t archive;
+  readArchive(filename, archive);
+
+  REQUIRE(archive.zip64);
+
+  uint64_t total = 0;
+  size_t corrupted = 0;
+  for (const auto& [name, entry] : archive.entries)
+  {
+    total += entry.size;
+    if (entry.method == ZIP_METHOD_STORE)
+      corrupted += crc32_update(0, std::as_bytes(entry.data)) != entry.crc;
+    else
+      content(entry);
+  }
+
+  REQUIRE(corrupted == 0);
+  REQUIRE(total > uint64_t(digital_size) * sizeof(float) * MAX_ANALOG_CHANNELS);
+  REQUIRE(archive.entries["logic-1-1"].offset > (uint64_t(1) << 32));
+
+  archive.file.close();
+  std::filesystem::remove(filename);
+  std::filesystem::remove(capture);
+}
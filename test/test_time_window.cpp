@@ -0,0 +1,83 @@
+#include "catch.hpp"
+
+#include "../time_window.hpp"
+#include "../siglent_bin.hpp"
+#include "../member_stream.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+TEST_CASE("Time window selects samples relative to the trigger", "[time-window]") {
+  header_t header = {};
+  // 14 divisions of 1 ms, trigger 2 ms after the center of the screen: the capture spans -9 ms to 5 ms
+  header.time_div = { 1e-3, magnitude_t::IU, unit_t::S };
+  header.time_delay = { 2e-3, magnitude_t::IU, unit_t::S };
+  const double rate = 1e6;
+  const size_t total = 14000;
+
+  REQUIRE(captureStartTime(header) == Approx(-9e-3));
+
+  auto window = timeWindow(header, rate, total, -INF, INF);
+  REQUIRE(window.begin == 0);
+  REQUIRE(window.end == total);
+
+  // Bounds on sample times include them, whatever the rounding of the header values
+  window = timeWindow(header, rate, total, -1e-3, 1e-3);
+  REQUIRE(window.begin == 8000);
+  REQUIRE(window.end == 10001);
+
+  // Bounds between samples round inwards
+  window = timeWindow(header, rate, total, -1.0005e-3, 0.9995e-3);
+  REQUIRE(window.begin == 8000);
+  REQUIRE(window.end == 10000);
+
+  // Bounds out of the capture are clamped to it
+  window = timeWindow(header, rate, total, -1, 0);
+  REQUIRE(window.begin == 0);
+  REQUIRE(window.end == 9001);
+  window = timeWindow(header, rate, total, 4.5e-3, INF);
+  REQUIRE(window.begin == 13500);
+  REQUIRE(window.end == total);
+
+  REQUIRE_THROWS(timeWindow(header, rate, total, 1e-3, -1e-3));
+  REQUIRE_THROWS(timeWindow(header, rate, total, 6e-3, 7e-3));
+  REQUIRE_THROWS(timeWindow(header, rate, total, 0.2e-6, 0.8e-6));
+  REQUIRE_THROWS(timeWindow(header, 0, total, -INF, INF));
+}
+
+TEST_CASE("Trimmed members start and end within reader units", "[time-window]") {
+  auto file = std::make_shared<const MappedFile>("test-digital-5ch.bin");
+
+  auto drain = [] (const member_source_t& member) {
+    std::vector<std::byte> data(member.size);
+    auto producer = member.open();
+    size_t done = 0;
+    // Odd reads: the trimmed end must not depend on them
+    while (size_t n = producer(std::span(data).subspan(done, std::min<size_t>(7, data.size() - done))))
+      done += n;
+    REQUIRE(done == member.size);
+    REQUIRE(producer(std::span(data)) == 0);
+    return data;
+  };
+
+  SiglentDigitalReader reader(0, 5, 8);
+  reader.open(file);
+  const auto full = drain(logicMember(reader, 64));
+
+  // Samples 3 to 45: octets 0 to 5 read, 3 samples dropped before and 3 after
+  const auto member = trimMember(logicMember(reader, 48), 3 * sizeof(uint16_t), 42 * sizeof(uint16_t));
+  REQUIRE(member.size == 42 * sizeof(uint16_t));
+
+  const auto trimmed = drain(member);
+  REQUIRE(std::memcmp(trimmed.data(), full.data() + 3 * sizeof(uint16_t), trimmed.size()) == 0);
+
+  // Untrimmed members are left as they are, out of range trims are errors
+  auto whole = logicMember(reader, 16);
+  REQUIRE(trimMember(whole, 0, whole.size).size == whole.size);
+  REQUIRE_THROWS(trimMember(whole, 2, whole.size));
+}
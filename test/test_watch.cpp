@@ -0,0 +1,149 @@
+#include "catch.hpp"
+
+#include "../watch.hpp"
+#include "../batch.hpp"
+#include "helpers.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+TEST_CASE("Folder watcher reports completed captures", "[watch]") {
+  const fs::path dir = "test-watch-events";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+
+  FolderWatcher watcher(dir);
+
+  // Still open: not reported yet
+  std::ofstream saving(dir / "SDS00001.bin");
+  saving << "partial";
+  saving.flush();
+
+  std::ofstream(dir / "notes.txt") << "x";
+  std::ofstream(dir / "elsewhere.tmp") << "x";
+  fs::rename(dir / "elsewhere.tmp", dir / "SDS00002.BIN");
+
+  auto completed = watcher.wait();
+  REQUIRE(completed == std::vector<fs::path>{ dir / "SDS00002.BIN" });
+
+  saving.close();
+  completed = watcher.wait();
+  REQUIRE(completed == std::vector<fs::path>{ dir / "SDS00001.bin" });
+
+  // Once stopped, for good
+  watcher.stop();
+  REQUIRE(watcher.wait().empty());
+  REQUIRE(watcher.wait().empty());
+
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Folder watcher rescans the folder when events are lost", "[watch]") {
+  const fs::path dir = "test-watch-overflow";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+
+  size_t max_events = 0;
+  std::ifstream("/proc/sys/fs/inotify/max_queued_events") >> max_events;
+  if (max_events == 0 || max_events > 100000)
+  {
+    WARN("inotify queue too large to overflow, skipped");
+    return;
+  }
+
+  FolderWatcher watcher(dir);
+
+  // More files saved than the kernel queues events for, nobody reading them: the captures saved next are lost
+  for (size_t i = 0; i <= max_events; i++)
+    std::ofstream(dir / ("notes-" + std::to_string(i) + ".txt")) << "x";
+
+  std::ofstream(dir / "SDS00002.bin") << "x";
+  std::ofstream(dir / "SDS00001.bin") << "x";
+
+  // Written after the overflow is noticed: still being saved, to be reported by its own close-write
+  std::ofstream(dir / "SDS00004.bin") << "x";
+  fs::last_write_time(dir / "SDS00004.bin", fs::file_time_type::clock::now() + std::chrono::hours(1));
+
+  // Only what the folder holds is left: captures the caller has not handled, in name order
+  auto completed = watcher.wait([&dir] (const fs::path& p) { return p != dir / "SDS00001.bin"; });
+  REQUIRE(completed == std::vector<fs::path>{ dir / "SDS00002.bin" });
+
+  // Still watching
+  std::ofstream(dir / "SDS00003.bin") << "x";
+  completed = watcher.wait();
+  REQUIRE(completed == std::vector<fs::path>{ dir / "SDS00003.bin" });
+
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Watched folder captures are converted as they are saved", "[watch]") {
+  const fs::path dir = "test-watch-convert";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "out");
+
+  FolderWatcher watcher(dir);
+
+  batch_options_t options;
+  options.conversion.jobs = 2;
+  options.output_dir = dir / "out";
+
+  batch_summary_t summary;
+  std::thread daemon([&] { summary = watchFolder(watcher, options); });
+
+  writeSyntheticCapture((dir / "SDS00001.bin").string(), 2, 20000, 4);
+  writeSyntheticCapture((dir / "SDS00002.bin").string(), 1, 5000, 0);
+
+  // Archives are created as their conversion starts, the watcher finishes them before returning
+  for (int i = 0; i < 1000 && !(fs::exists(dir / "out" / "SDS00001.srzip") && fs::exists(dir / "out" / "SDS00002.srzip")); i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  watcher.stop();
+  daemon.join();
+
+  REQUIRE(summary.converted == 2);
+  REQUIRE(summary.failed == 0);
+  REQUIRE(fs::file_size(dir / "out" / "SDS00001.srzip") > 0);
+
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Watched folder survives a malformed capture", "[watch]") {
+  const fs::path dir = "test-watch-malformed";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "out");
+
+  FolderWatcher watcher(dir);
+
+  batch_options_t options;
+  options.conversion.jobs = 2;
+  options.parallel_files = 1;
+  options.output_dir = dir / "out";
+
+  batch_summary_t summary;
+  std::thread daemon([&] { summary = watchFolder(watcher, options); });
+
+  // Logic probes on, fewer logic samples than analog ones: moved in once complete
+  writeSyntheticCapture((dir / "malformed.tmp").string(), 1, 1000, 2);
+  setHeaderField((dir / "malformed.tmp").string(), 0x108, 16);
+  fs::rename(dir / "malformed.tmp", dir / "SDS00001.bin");
+
+  writeSyntheticCapture((dir / "SDS00002.bin").string(), 1, 5000, 0);
+
+  for (int i = 0; i < 1000 && !fs::exists(dir / "out" / "SDS00002.srzip"); i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  watcher.stop();
+  daemon.join();
+
+  REQUIRE(summary.failed == 1);
+  REQUIRE(summary.converted == 1);
+  REQUIRE_FALSE(fs::exists(dir / "out" / "SDS00001.srzip"));
+  REQUIRE(fs::file_size(dir / "out" / "SDS00002.srzip") > 0);
+
+  fs::remove_all(dir);
+}
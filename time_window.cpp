@@ -0,0 +1,42 @@
+#include "time_window.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "siglent_bin.hpp"
+
+// Bounds falling within this fraction of a sample of a sample time include it,
+// whatever the rounding of the header values
+const double SAMPLE_TOLERANCE = 1e-6;
+
+double captureStartTime(const header_t& header)
+{
+  return -SCREEN_DIVISIONS / 2 * header.time_div.value - header.time_delay.value;
+}
+
+sample_range_t timeWindow(const header_t& header, double sample_rate, size_t total, double from, double to)
+{
+  if (from > to)
+    throw std::runtime_error("Time window ends before it starts");
+
+  if (!(sample_rate > 0))
+    throw std::runtime_error("Capture has no sample rate, a time window cannot be located");
+
+  const double start = captureStartTime(header);
+
+  // Sample i is at start + i / sample_rate
+  const double first = std::ceil((from - start) * sample_rate - SAMPLE_TOLERANCE);
+  const double last = std::floor((to - start) * sample_rate + SAMPLE_TOLERANCE);
+
+  sample_range_t range;
+  range.begin = size_t(std::clamp(first, 0.0, double(total)));
+  range.end = size_t(std::clamp(last + 1, 0.0, double(total)));
+
+  if (range.begin >= range.end)
+    throw std::runtime_error("No sample between " + std::to_string(from) + " s and " + std::to_string(to) +
+      " s: the capture spans " + std::to_string(start) + " s to " + std::to_string(start + total / sample_rate) + " s");
+
+  return range;
+}
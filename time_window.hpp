@@ -0,0 +1,29 @@
+#ifndef TIME_WINDOW_HPP_
+#define TIME_WINDOW_HPP_
+
+#include <cstddef>
+
+struct header_t;
+
+// Horizontal divisions of the SDS1000X-E screen. A capture spans SCREEN_DIVISIONS * time_div,
+// its first sample at -SCREEN_DIVISIONS / 2 * time_div - time_delay from the trigger
+// (the trigger is at the center of the screen when there is no delay).
+const double SCREEN_DIVISIONS = 14;
+
+// Samples [begin, end) of a timebase
+struct sample_range_t {
+  size_t begin;
+  size_t end;
+
+  size_t size() const { return end - begin; }
+};
+
+// Time of the first sample relative to the trigger, in seconds
+double captureStartTime(const header_t& header);
+
+// Samples of a timebase of total samples at sample_rate whose time, relative to the trigger,
+// lies within [from, to] seconds. Infinite bounds select from the first or up to the last sample.
+// Throws if the window holds no sample.
+sample_range_t timeWindow(const header_t& header, double sample_rate, size_t total, double from, double to);
+
+#endif // TIME_WINDOW_HPP_
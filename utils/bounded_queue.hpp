@@ -0,0 +1,72 @@
+#ifndef BOUNDED_QUEUE_HPP_
+#define BOUNDED_QUEUE_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Blocking FIFO holding at most capacity items, used to connect pipeline stages.
+// Once closed, push fails and pop drains what is left, then returns nothing.
+template<typename T>
+class BoundedQueue
+{
+  public:
+
+    explicit BoundedQueue(size_t capacity)
+    : capacity(capacity)
+    {
+    }
+
+    bool push(T item)
+    {
+      std::unique_lock lock(m);
+      not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+
+      if (closed)
+        return false;
+
+      items.push_back(std::move(item));
+      not_empty.notify_one();
+      return true;
+    }
+
+    std::optional<T> pop()
+    {
+      std::unique_lock lock(m);
+      not_empty.wait(lock, [this] { return closed || !items.empty(); });
+
+      if (items.empty())
+        return std::nullopt;
+
+      T item = std::move(items.front());
+      items.pop_front();
+      not_full.notify_one();
+      return item;
+    }
+
+    void close()
+    {
+      std::lock_guard lock(m);
+      closed = true;
+      not_full.notify_all();
+      not_empty.notify_all();
+    }
+
+  private:
+
+    const size_t capacity;
+
+    std::deque<T> items;
+
+    bool closed = false;
+
+    std::mutex m;
+
+    std::condition_variable not_full;
+
+    std::condition_variable not_empty;
+};
+
+#endif // BOUNDED_QUEUE_HPP_
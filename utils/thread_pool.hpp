@@ -0,0 +1,92 @@
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted tasks in FIFO order
+class ThreadPool
+{
+  public:
+
+    explicit ThreadPool(size_t threads)
+    {
+      if (threads == 0)
+        threads = 1;
+
+      for (size_t i = 0; i < threads; i++)
+        workers.emplace_back([this] { run(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs the tasks already submitted, then stops
+    ~ThreadPool()
+    {
+      {
+        std::lock_guard lock(m);
+        stopping = true;
+      }
+      wake.notify_all();
+
+      for (auto& worker : workers)
+        worker.join();
+    }
+
+    size_t size() const { return workers.size(); }
+
+    template<typename F>
+    auto submit(F&& f) -> std::future<decltype(f())>
+    {
+      auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::forward<F>(f));
+      auto ret = task->get_future();
+
+      {
+        std::lock_guard lock(m);
+        tasks.emplace_back([task] { (*task)(); });
+      }
+      wake.notify_one();
+
+      return ret;
+    }
+
+  private:
+
+    void run()
+    {
+      for (;;)
+      {
+        std::function<void()> task;
+        {
+          std::unique_lock lock(m);
+          wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+          if (tasks.empty())
+            return;
+
+          task = std::move(tasks.front());
+          tasks.pop_front();
+        }
+        task();
+      }
+    }
+
+    std::vector<std::thread> workers;
+
+    std::deque<std::function<void()>> tasks;
+
+    bool stopping = false;
+
+    std::mutex m;
+
+    std::condition_variable wake;
+};
+
+#endif // THREAD_POOL_HPP_
@@ -0,0 +1,137 @@
+#include "watch.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include "batch.hpp"
+
+FolderWatcher::FolderWatcher(const std::filesystem::path& dir)
+  : dir(dir)
+{
+  inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  if (inotify_fd < 0)
+    throw std::runtime_error(std::string("Failed watching folders: ") + std::strerror(errno));
+
+  // Close after write: a capture saved in place. Moved to: a capture written elsewhere then renamed.
+  if (inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+  {
+    const int err = errno;
+    ::close(inotify_fd);
+    throw std::runtime_error("Failed watching " + dir.string() + ": " + std::strerror(err));
+  }
+
+  stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (stop_fd < 0)
+  {
+    const int err = errno;
+    ::close(inotify_fd);
+    throw std::runtime_error(std::string("Failed watching folders: ") + std::strerror(err));
+  }
+}
+
+FolderWatcher::~FolderWatcher()
+{
+  ::close(inotify_fd);
+  ::close(stop_fd);
+}
+
+void FolderWatcher::stop() const
+{
+  const uint64_t one = 1;
+  // Nothing to do on failure: the counter is already set
+  [[maybe_unused]] ssize_t n = ::write(stop_fd, &one, sizeof(one));
+}
+
+// Captures of dir last written up to before, for which unhandled returns true, in name order
+static std::vector<std::filesystem::path> rescan(const std::filesystem::path& dir, std::filesystem::file_time_type before,
+  const std::function<bool(const std::filesystem::path&)>& unhandled)
+{
+  std::vector<std::filesystem::path> captures;
+
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec))
+    if (entry.is_regular_file(ec) && isCaptureName(entry.path()) && entry.last_write_time(ec) <= before &&
+        (!unhandled || unhandled(entry.path())))
+      captures.push_back(entry.path());
+
+  if (ec)
+    throw std::runtime_error("Failed listing " + dir.string() + ": " + ec.message());
+
+  std::sort(captures.begin(), captures.end());
+  return captures;
+}
+
+std::vector<std::filesystem::path> FolderWatcher::wait(const std::function<bool(const std::filesystem::path&)>& unhandled)
+{
+  std::vector<std::filesystem::path> completed;
+
+  // Events are variable length records, aligned as their header
+  alignas(inotify_event) char buffer[64 * (sizeof(inotify_event) + NAME_MAX + 1)];
+
+  while (completed.empty())
+  {
+    pollfd fds[2] = { { stop_fd, POLLIN, 0 }, { inotify_fd, POLLIN, 0 } };
+
+    if (poll(fds, 2, -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error(std::string("Failed watching folders: ") + std::strerror(errno));
+    }
+
+    // The counter is never reset: once stopped, every wait returns at once
+    if (fds[0].revents & POLLIN)
+      return {};
+
+    ssize_t len = ::read(inotify_fd, buffer, sizeof(buffer));
+    // The overflow event is the last queued: from now on, events are queued again
+    const auto drained = std::filesystem::file_time_type::clock::now();
+    if (len < 0)
+    {
+      if (errno == EAGAIN || errno == EINTR)
+        continue;
+      throw std::runtime_error(std::string("Failed watching folders: ") + std::strerror(errno));
+    }
+
+    bool overflowed = false;
+
+    for (ssize_t p = 0; p < len; )
+    {
+      const auto* event = reinterpret_cast<const inotify_event*>(buffer + p);
+      p += sizeof(inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        overflowed = true;
+        continue;
+      }
+
+      if (event->len == 0 || (event->mask & IN_ISDIR))
+        continue;
+
+      std::filesystem::path path = dir / event->name;
+      if (isCaptureName(path))
+        completed.push_back(std::move(path));
+    }
+
+    // Events were lost: the folder itself tells which captures are left. Events read along are in it too.
+    // Captures written since the queue drained are left out: possibly still being written, their close-write is coming.
+    if (overflowed)
+    {
+      spdlog::warn("Too many files saved at once in {}, rescanning it", dir.string());
+      completed = rescan(dir, drained, unhandled);
+    }
+  }
+
+  return completed;
+}
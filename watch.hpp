@@ -0,0 +1,41 @@
+#ifndef WATCH_HPP_
+#define WATCH_HPP_
+
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+// Reports captures (.bin files) completed in a folder: closed after being written, or moved into it.
+// Files still being written are not reported until their writer closes them.
+class FolderWatcher
+{
+  public:
+
+    explicit FolderWatcher(const std::filesystem::path& dir);
+
+    FolderWatcher(const FolderWatcher&) = delete;
+    FolderWatcher& operator=(const FolderWatcher&) = delete;
+
+    ~FolderWatcher();
+
+    // Blocks until captures are completed, returns them in event order; empty once stopped.
+    // When the kernel event queue overflows, the events lost are replaced by a rescan of the folder:
+    // every capture in it for which unhandled returns true (all of them without unhandled), in name order.
+    // Captures written after the queue drained are left out: their own events report them once complete.
+    std::vector<std::filesystem::path> wait(const std::function<bool(const std::filesystem::path&)>& unhandled = {});
+
+    // Makes wait() return empty, now and from then on. Async-signal-safe: may be called from a signal handler.
+    void stop() const;
+
+    const std::filesystem::path& folder() const { return dir; }
+
+  private:
+
+    std::filesystem::path dir;
+
+    int inotify_fd;
+
+    int stop_fd;
+};
+
+#endif // WATCH_HPP_